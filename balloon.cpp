@@ -1,8 +1,8 @@
 #include "pch.h"
+#include "MeshIO.h"
 #include "NormalForce.h"
 #include "Solver.h"
 #include "Constraint.h"
-#include <fstream>
 #include <iostream>
 #include <vector>
 
@@ -107,28 +107,11 @@ int main() {
     }
 
     // Write mesh to OBJ file
-    std::ofstream objFile("balloon_with_normal_force.obj");
-    if (objFile.is_open()) {
-        // Write vertices
-        for (int i = 0; i < finalPoints.cols(); ++i) {
-            objFile << "v " << finalPoints(0, i) << " " << finalPoints(1, i) << " " << finalPoints(2, i) << "\n";
-        }
-
-        // Write faces
-        for (int y = 0; y < rows - 1; ++y) {
-            for (int x = 0; x < cols - 1; ++x) {
-                int v1 = index(x, y) + 1;
-                int v2 = index(x + 1, y) + 1;
-                int v3 = index(x + 1, y + 1) + 1;
-                int v4 = index(x, y + 1) + 1;
-                objFile << "f " << v1 << " " << v2 << " " << v3 << " " << v4 << "\n";
-            }
-        }
-
-        objFile.close();
+    try {
+        ShapeOp::writeOBJ("balloon_with_normal_force.obj", ShapeOp::gridMesh(finalPoints, rows, cols));
         std::cout << "Mesh written to balloon_with_normal_force.obj" << std::endl;
-    } else {
-        std::cerr << "Failed to open OBJ file for writing." << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
     }
 
     return 0;
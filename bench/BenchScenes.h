@@ -0,0 +1,195 @@
+#pragma once
+
+// Procedural scenes shared by the benchmarks, built the same way as the example drivers.
+
+#include "Constraint.h"
+#include "ConstraintBuilder.h"
+#include "NormalForce.h"
+#include "Types.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace bench {
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Flat rows x cols grid in the XZ plane, as in wind_cloth.cpp
+inline ShapeOp::Matrix3X clothGrid(int rows, int cols, double spacing = 1.0) {
+    ShapeOp::Matrix3X points(3, rows * cols);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            points.col(y * cols + x) = ShapeOp::Vector3(x * spacing, 0.0, y * spacing);
+        }
+    }
+    return points;
+}
+
+// Two triangles per grid quad, as in balloon.cpp
+inline std::vector<std::vector<int>> gridTriangles(int rows, int cols) {
+    std::vector<std::vector<int>> faces;
+    faces.reserve(2 * (rows - 1) * (cols - 1));
+    for (int y = 0; y < rows - 1; ++y) {
+        for (int x = 0; x < cols - 1; ++x) {
+            int v1 = y * cols + x;
+            int v2 = v1 + 1;
+            int v3 = v2 + cols;
+            int v4 = v1 + cols;
+            faces.push_back({v1, v2, v3});
+            faces.push_back({v1, v3, v4});
+        }
+    }
+    return faces;
+}
+
+// Corner pins plus horizontal and vertical edge constraints, as in wind_cloth.cpp.
+// Works with ShapeOp::Solver and ShapeOp::ExtendedSolver alike.
+template <typename SolverT>
+void addClothConstraints(SolverT &solver, int rows, int cols, double edgeWeight = 10.0, double cornerWeight = 1e5) {
+    auto index = [cols](int x, int y) { return y * cols + x; };
+
+    for (int id : {index(0, 0), index(cols - 1, rows - 1)}) {
+        solver.addConstraint(std::make_shared<ShapeOp::ClosenessConstraint>(
+            std::vector<int>{id}, cornerWeight, solver.getPoints()));
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols - 1; ++x) {
+            solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                std::vector<int>{index(x, y), index(x + 1, y)}, edgeWeight, solver.getPoints(), 0.8, 1.2));
+        }
+    }
+    for (int y = 0; y < rows - 1; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                std::vector<int>{index(x, y), index(x, y + 1)}, edgeWeight, solver.getPoints(), 0.8, 1.2));
+        }
+    }
+}
+
+// cable_net.cpp: two diagonal corners lifted by liftHeight, the other two held on the
+// ground, every cable shrunk to shrinkFactor of its length, on a 2 x 2 square
+template <typename SolverT>
+void cableNet(SolverT &solver, int size, double shrinkFactor = 0.5, double liftHeight = 1.0) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    ShapeOp::Matrix3X points(3, size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            points.col(index(x, y)) = ShapeOp::Vector3(x * 2.0 / (size - 1), y * 2.0 / (size - 1), 0.0);
+        }
+    }
+    solver.setPoints(points);
+
+    for (int id : {index(0, 0), index(size - 1, size - 1), index(size - 1, 0), index(0, size - 1)}) {
+        auto pin = std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{id}, 1e5, solver.getPoints());
+        if (id == index(0, 0) || id == index(size - 1, size - 1)) {
+            pin->setPosition(points.col(id) + ShapeOp::Vector3(0.0, 0.0, liftHeight));
+        }
+        solver.addConstraint(pin);
+    }
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            for (int next : {x + 1 < size ? index(x + 1, y) : -1, y + 1 < size ? index(x, y + 1) : -1}) {
+                if (next < 0) continue;
+                solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                    std::vector<int>{index(x, y), next}, 100.0, solver.getPoints(), shrinkFactor - 0.05,
+                    shrinkFactor + 0.05));
+            }
+        }
+    }
+}
+
+// unary_force.cpp: corners and center pinned, unit edges, a small constant force
+template <typename SolverT>
+void unaryForceNet(SolverT &solver, int size = 14) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    ShapeOp::Matrix3X points(3, size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            points.col(index(x, y)) = ShapeOp::Vector3(x, -y, 0.0);
+        }
+    }
+    solver.setPoints(points);
+
+    for (int id : {index(0, 0), index(size - 1, 0), index(0, size - 1), index(size - 1, size - 1),
+                   index(size / 2, size / 2)}) {
+        solver.addConstraint(
+            std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{id}, 1e5, solver.getPoints()));
+    }
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            for (int next : {x + 1 < size ? index(x + 1, y) : -1, y + 1 < size ? index(x, y + 1) : -1}) {
+                if (next < 0) continue;
+                solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                    std::vector<int>{index(x, y), next}, 1.0, solver.getPoints()));
+            }
+        }
+    }
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, 0.0, 0.001)));
+}
+
+// Closed, outward-facing triangulated surface of a unit cube with n x n quads per side,
+// a stand-in for balloon_box.cpp's data/m0.obj
+inline void boxSurface(int n, ShapeOp::Matrix3X &points, std::vector<std::vector<int>> &faces) {
+    std::map<std::tuple<int, int, int>, int> ids;
+    std::vector<ShapeOp::Vector3> vertices;
+    auto vertex = [&](int a, int u, int v, int axis) {
+        int c[3];
+        c[axis] = a;
+        c[(axis + 1) % 3] = u;
+        c[(axis + 2) % 3] = v;
+        auto inserted = ids.emplace(std::make_tuple(c[0], c[1], c[2]), static_cast<int>(vertices.size()));
+        if (inserted.second) {
+            vertices.emplace_back(c[0] / double(n), c[1] / double(n), c[2] / double(n));
+        }
+        return inserted.first->second;
+    };
+
+    faces.clear();
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side : {0, n}) {
+            for (int u = 0; u < n; ++u) {
+                for (int v = 0; v < n; ++v) {
+                    int q[4] = {vertex(side, u, v, axis), vertex(side, u + 1, v, axis),
+                                vertex(side, u + 1, v + 1, axis), vertex(side, u, v + 1, axis)};
+                    if (side == 0) std::swap(q[1], q[3]);
+                    faces.push_back({q[0], q[1], q[2]});
+                    faces.push_back({q[0], q[2], q[3]});
+                }
+            }
+        }
+    }
+
+    points.resize(3, vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        points.col(i) = vertices[i];
+    }
+}
+
+// balloon_box.cpp on boxSurface(n): weak closeness everywhere, three strong pins,
+// packed edge strain and an inflating normal force
+template <typename SolverT>
+void balloonBox(SolverT &solver, int n = 12) {
+    ShapeOp::Matrix3X points;
+    std::vector<std::vector<int>> faces;
+    boxSurface(n, points, faces);
+    solver.setPoints(points);
+
+    ShapeOp::ConstraintBuilder builder(solver.getPoints());
+    std::vector<std::shared_ptr<ShapeOp::Constraint>> closeness;
+    const int count = static_cast<int>(points.cols());
+    builder.closeness(Eigen::VectorXi::LinSpaced(count, 0, count - 1), 0.001, closeness);
+    ShapeOp::addConstraints(solver, closeness);
+    for (int id : {0, 100 % count, 350 % count}) {
+        solver.addConstraint(
+            std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{id}, 1000, solver.getPoints()));
+    }
+    solver.addConstraint(builder.edgeStrainBlock(ShapeOp::ConstraintBuilder::uniqueEdges(faces), 0.1));
+    solver.addForces(std::make_shared<ShapeOp::NormalForce>(faces, 0.1));
+}
+
+} // namespace bench
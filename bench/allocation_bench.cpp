@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ContactConstraint.h"
+#include "ExtendedSolver.h"
+#include "MeshIO.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Heap allocations in steady-state solve() calls: after initialize() and warm-up steps
+// (enough for the cloth's contact count to peak; contact buffers only grow at a new
+// high), counts every malloc-family call during the given number of iterations and
+// reports the per-call latency spread. Iterations run as solve(1) calls, except with
+// Anderson and Chebyshev acceleration, which only accelerate within one call: those
+// run solve(10) with a zero tolerance. The wind_cloth.cpp --contact scene (edge
+// strain, corner pins, contact and gravity, dynamic) runs with each global step option;
+// the accelerated runs leave contact out, as its rows switch in most calls of ten
+// iterations. Then static scenes: balloon_box.cpp (closeness, packed edge strain and
+// the normal force) and cable_net.cpp with multigrid cycles and with a pending
+// low-rank update. Exits with 1 if any call allocated. Calls in which cloth vertices
+// came into or out of contact are counted apart and don't fail the run: switching
+// their rows updates the factorization, and the refactorization allocates inside
+// Eigen. The incomplete Cholesky preconditioner is left out: Eigen's
+// IncompleteCholesky::solve allocates temporaries. In an OpenMP build, libgomp
+// allocates a team for every parallel region that runs on a single thread
+// (OMP_NUM_THREADS=1 or one core); teams of two or more threads are reused.
+// Usage: allocation_bench [iterations] [warm-up iterations] [cloth size]
+
+// Counting hook: this executable's malloc family interposes glibc's for every library,
+// operator new and Eigen's aligned allocations included, and forwards to it
+extern "C" {
+void *__libc_malloc(std::size_t);
+void *__libc_calloc(std::size_t, std::size_t);
+void *__libc_realloc(void *, std::size_t);
+void *__libc_memalign(std::size_t, std::size_t);
+void __libc_free(void *);
+}
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<long> allocations{0};
+
+inline void count() {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+extern "C" {
+void *malloc(std::size_t size) noexcept {
+    count();
+    return __libc_malloc(size);
+}
+void *calloc(std::size_t n, std::size_t size) noexcept {
+    count();
+    return __libc_calloc(n, size);
+}
+void *realloc(void *p, std::size_t size) noexcept {
+    count();
+    return __libc_realloc(p, size);
+}
+void *memalign(std::size_t alignment, std::size_t size) noexcept {
+    count();
+    return __libc_memalign(alignment, size);
+}
+void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+    count();
+    return __libc_memalign(alignment, size);
+}
+int posix_memalign(void **p, std::size_t alignment, std::size_t size) noexcept {
+    count();
+    *p = __libc_memalign(alignment, size);
+    return *p ? 0 : 12; // ENOMEM
+}
+void free(void *p) noexcept {
+    __libc_free(p);
+}
+}
+
+namespace {
+
+struct Result {
+    long allocations;
+    long switchAllocations = 0; // In calls that switched contact rows, not in allocations
+    int switchCalls = 0;
+    double meanUs, deviationUs, p99Us, maxUs;
+};
+
+Result measure(ShapeOp::ExtendedSolver &solver, int iterations, int warmup,
+               const ShapeOp::ContactConstraint *contact = nullptr, int perCall = 1) {
+    for (int k = 0; k < warmup / perCall; ++k) solver.solve(perCall);
+    const int calls = std::max(1, iterations / perCall);
+    std::vector<double> latencies(calls);
+    Result r;
+    allocations = 0;
+    counting = true;
+    for (int k = 0; k < calls; ++k) {
+        const long before = allocations;
+        const long switches = contact ? contact->getSwitches() : 0;
+        const auto start = std::chrono::steady_clock::now();
+        solver.solve(perCall);
+        latencies[k] = bench::elapsedMs(start) * 1e3;
+        if (contact && contact->getSwitches() != switches) {
+            r.switchAllocations += allocations - before;
+            ++r.switchCalls;
+        }
+    }
+    counting = false;
+
+    r.allocations = allocations - r.switchAllocations;
+    double sum = 0.0, squares = 0.0;
+    for (double t : latencies) {
+        sum += t;
+        squares += t * t;
+    }
+    r.meanUs = sum / calls;
+    r.deviationUs = std::sqrt(std::max(0.0, squares / calls - r.meanUs * r.meanUs));
+    std::sort(latencies.begin(), latencies.end());
+    r.p99Us = latencies[std::min(calls - 1, calls * 99 / 100)];
+    r.maxUs = latencies.back();
+    return r;
+}
+
+const ShapeOp::ContactConstraint *windCloth(ShapeOp::ExtendedSolver &solver, int size, bool withContact = true) {
+    solver.setPoints(bench::clothGrid(size, size));
+    bench::addClothConstraints(solver, size, size);
+    std::shared_ptr<ShapeOp::ContactConstraint> contact;
+    if (withContact) {
+        contact = std::make_shared<ShapeOp::ContactConstraint>(
+            ShapeOp::gridMesh(solver.getPoints(), size, size).faceList(), 1.0, solver.getPoints(), 0.25);
+        solver.addConstraint(contact);
+    }
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    return contact.get();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int iterations = argc > 1 ? std::stoi(argv[1]) : 1000;
+    const int warmup = argc > 2 ? std::stoi(argv[2]) : 300;
+    const int size = argc > 3 ? std::stoi(argv[3]) : 20;
+    std::cout << iterations << " iterations per scene after " << warmup << " warm-up iterations" << std::endl;
+    long total = 0;
+    auto report = [&](const std::string &name, const Result &r) {
+        std::cout << name << ": " << r.allocations << " allocations, per call mean " << r.meanUs
+                  << " us, deviation " << r.deviationUs << " us, p99 " << r.p99Us << " us, max " << r.maxUs << " us";
+        if (r.switchCalls > 0) {
+            std::cout << "; " << r.switchAllocations << " more in " << r.switchCalls << " calls switching contact rows";
+        }
+        std::cout << std::endl;
+        total += r.allocations;
+    };
+    auto run = [&](const std::string &name, ShapeOp::ExtendedSolver &solver, bool dynamic,
+                   const ShapeOp::ContactConstraint *contact = nullptr, int perCall = 1) {
+        solver.initialize(dynamic);
+        report(name, measure(solver, iterations, warmup, contact, perCall));
+    };
+
+    const std::string cloth = "wind_cloth " + std::to_string(size) + "x" + std::to_string(size);
+    {
+        ShapeOp::ExtendedSolver solver;
+        const auto contact = windCloth(solver, size);
+        run(cloth, solver, true, contact);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        const auto contact = windCloth(solver, size);
+        solver.fixVertex(0);
+        solver.fixVertex(size * size - 1);
+        run(cloth + ", hard pins", solver, true, contact);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        const auto contact = windCloth(solver, size);
+        solver.fixVertex(0);
+        solver.setGlobalSolver(ShapeOp::ExtendedSolver::GlobalSolver::ConjugateGradient);
+        run(cloth + ", conjugate gradient", solver, true, contact);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        windCloth(solver, size, false);
+        solver.setAndersonWindow(5);
+        solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Energy, 0.0);
+        run(cloth + ", Anderson, solve(10)", solver, true, nullptr, 10);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        windCloth(solver, size, false);
+        solver.setChebyshev(true, 0.9);
+        solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Residual, 0.0);
+        run(cloth + ", Chebyshev, solve(10)", solver, true, nullptr, 10);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        bench::balloonBox(solver);
+        run("balloon_box", solver, false);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        bench::cableNet(solver, 33);
+        solver.setHierarchy(3, 33, 33);
+        solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Displacement, 0.0);
+        run("cable_net 33x33, multigrid", solver, false);
+    }
+    {
+        ShapeOp::ExtendedSolver solver;
+        bench::cableNet(solver, 33);
+        solver.initialize(false);
+        solver.getConstraint(0)->setWeight(1e4);
+        solver.updateConstraints({0});
+        report("cable_net 33x33, low-rank update", measure(solver, iterations, warmup));
+    }
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Iterations and wall time to reach a residual tolerance with the plain local/global
+// iteration and with Anderson acceleration, on the cable_net, unary_force and
+// balloon_box scenes (the latter on a procedural box).
+// Usage: anderson_bench [tolerance] [max iterations]
+
+int main(int argc, char **argv) {
+    using Solver = ShapeOp::ExtendedSolver;
+    const double tolerance = argc > 1 ? std::stod(argv[1]) : 1e-4;
+    const unsigned int budget = argc > 2 ? std::stoi(argv[2]) : 20000;
+
+    const std::vector<std::pair<std::string, std::function<void(Solver &)>>> scenes = {
+        {"cable_net 10x10", [](Solver &s) { bench::cableNet(s, 10); }},
+        {"cable_net 50x50", [](Solver &s) { bench::cableNet(s, 50); }},
+        {"unary_force 14x14", [](Solver &s) { bench::unaryForceNet(s, 14); }},
+        {"unary_force 50x50", [](Solver &s) { bench::unaryForceNet(s, 50); }},
+        {"balloon_box 12", [](Solver &s) { bench::balloonBox(s, 12); }},
+    };
+    std::cout << "residual tolerance " << tolerance << ", budget " << budget << " iterations" << std::endl;
+
+    for (const auto &scene : scenes) {
+        std::cout << scene.first << std::endl;
+        for (int window : {0, 5, 10}) {
+            Solver solver;
+            scene.second(solver);
+            solver.initialize();
+            solver.setTolerance(Solver::StopCriterion::Residual, tolerance);
+            solver.setAndersonWindow(window);
+
+            auto start = std::chrono::steady_clock::now();
+            solver.solve(budget);
+            const double ms = bench::elapsedMs(start);
+            std::cout << "  " << (window ? "anderson m=" + std::to_string(window) : std::string("plain       "))
+                      << (window ? "  " : "") << ": " << solver.getIterations() << " iterations, " << ms
+                      << " ms, residual " << solver.getResidual() << ", " << solver.getFallbacks()
+                      << " fallbacks" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "ExtendedSolver.h"
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Setup time and peak RSS for building a cable net's edge constraints:
+//   shared  - std::vector + make_shared + addConstraint per edge (the example drivers)
+//   pooled  - ConstraintBuilder::edgeStrain, one pool reservation
+//   packed  - ConstraintBuilder::edgeStrainBlock, a single constraint
+// Each variant runs in its own child process so peak RSS is measured in isolation.
+// Usage: builder_bench [grid size]
+
+static Eigen::Matrix2Xi gridEdges(int rows, int cols) {
+    auto index = [cols](int x, int y) { return y * cols + x; };
+    Eigen::Matrix2Xi edges(2, rows * (cols - 1) + (rows - 1) * cols);
+    int e = 0;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols - 1; ++x) {
+            edges.col(e++) << index(x, y), index(x + 1, y);
+        }
+    }
+    for (int y = 0; y < rows - 1; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            edges.col(e++) << index(x, y), index(x, y + 1);
+        }
+    }
+    return edges;
+}
+
+static void build(const std::string &mode, int size) {
+    ShapeOp::ExtendedSolver solver;
+    solver.setPoints(bench::clothGrid(size, size));
+    Eigen::Matrix2Xi edges = gridEdges(size, size);
+
+    auto start = std::chrono::steady_clock::now();
+    if (mode == "shared") {
+        for (int k = 0; k < edges.cols(); ++k) {
+            std::vector<int> edgeIndices = {edges(0, k), edges(1, k)};
+            auto constraint = std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                edgeIndices, 100.0, solver.getPoints(), 0.45, 0.55);
+            solver.addConstraint(constraint);
+        }
+    } else if (mode == "pooled") {
+        ShapeOp::ConstraintBuilder builder(solver.getPoints());
+        std::vector<std::shared_ptr<ShapeOp::Constraint>> constraints;
+        builder.edgeStrain(edges, 100.0, 0.45, 0.55, constraints);
+        ShapeOp::addConstraints(solver, constraints);
+    } else if (mode == "packed") {
+        ShapeOp::ConstraintBuilder builder(solver.getPoints());
+        solver.addConstraint(builder.edgeStrainBlock(edges, 100.0, 0.45, 0.55));
+    }
+    if (mode != "none") {
+        std::cout << mode << ": " << bench::elapsedMs(start) << " ms setup, ";
+    }
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 708;
+    std::cout << size << "x" << size << " net, " << size * (size - 1) * 2 << " edges" << std::endl;
+
+    for (const std::string mode : {"none", "shared", "pooled", "packed"}) {
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            build(mode, size);
+            std::cout.flush();
+            _exit(0);
+        }
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        std::cout << (mode == "none" ? "points and edge list only: " : "") << "peak RSS " << usage.ru_maxrss / 1024
+                  << " MB" << std::endl;
+    }
+
+    return 0;
+}
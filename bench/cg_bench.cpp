@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "ExtendedSolver.h"
+#include <csignal>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Direct (LDLT) against conjugate gradient global steps on procedurally generated grids:
+// a cloth (dynamic, gravity, two pinned corners) and a cable net (static, corners pinned
+// and two lifted, every edge shrunk). Each size and solver runs in its own process so
+// its peak memory can be read; runs that exceed the time or address space limit are
+// reported as such. Checks first that CG reaches the direct solution on a small grid.
+// Usage: cg_bench [sizes, e.g. 100,250,500,1000,2000] [iterations] [time limit in s]
+//                 [address space limit in MB, 0 for none]
+
+namespace {
+
+using GlobalSolver = ShapeOp::ExtendedSolver::GlobalSolver;
+using Preconditioner = ShapeOp::ExtendedSolver::Preconditioner;
+
+struct Method {
+    const char *name;
+    GlobalSolver solver;
+    Preconditioner preconditioner;
+};
+
+const Method methods[] = {
+    {"direct", GlobalSolver::Direct, Preconditioner::Jacobi},
+    {"cg+jacobi", GlobalSolver::ConjugateGradient, Preconditioner::Jacobi},
+    {"cg+ic", GlobalSolver::ConjugateGradient, Preconditioner::IncompleteCholesky},
+};
+
+// size x size grid with one packed edge strain block and corner pins
+void buildGrid(ShapeOp::ExtendedSolver &solver, int size, bool cloth) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    solver.setPoints(bench::clothGrid(size, size, 1.0 / (size - 1)));
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (x + 1 < size) edges.col(e++) << index(x, y), index(x + 1, y);
+            if (y + 1 < size) edges.col(e++) << index(x, y), index(x, y + 1);
+        }
+    }
+    ShapeOp::ConstraintBuilder builder(solver.getPoints());
+    if (cloth) {
+        solver.addConstraint(builder.edgeStrainBlock(edges, 10.0, 0.8, 1.2));
+        solver.fixVertex(index(0, 0));
+        solver.fixVertex(index(size - 1, 0));
+        solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    } else {
+        solver.addConstraint(builder.edgeStrainBlock(edges, 100.0, 0.45, 0.55));
+        const ShapeOp::Vector3 lift(0.0, 1.0, 0.0);
+        solver.fixVertex(index(0, 0), solver.getPoints().col(index(0, 0)) + lift);
+        solver.fixVertex(index(size - 1, size - 1), solver.getPoints().col(index(size - 1, size - 1)) + lift);
+        solver.fixVertex(index(size - 1, 0));
+        solver.fixVertex(index(0, size - 1));
+    }
+}
+
+// Initializes and runs iterations local/global iterations (one solve() call per
+// iteration for the cloth, one call for the net); returns a report line
+std::string run(int size, bool cloth, const Method &method, int iterations, ShapeOp::Matrix3X *points = nullptr) {
+    ShapeOp::ExtendedSolver solver;
+    buildGrid(solver, size, cloth);
+    solver.setGlobalSolver(method.solver, method.preconditioner);
+    auto start = std::chrono::steady_clock::now();
+    const bool ok = solver.initialize(cloth);
+    const double initializeMs = bench::elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    unsigned long linear = 0;
+    if (cloth) {
+        for (int k = 0; k < iterations; ++k) {
+            solver.solve(1);
+            linear += solver.getLinearIterations();
+        }
+    } else {
+        solver.solve(iterations);
+        linear = solver.getLinearIterations();
+    }
+    const double iterationMs = bench::elapsedMs(start) / iterations;
+    if (points) *points = solver.getPoints();
+
+    std::ostringstream line;
+    line << "initialize " << initializeMs << " ms, " << iterationMs << " ms/iteration";
+    if (method.solver == GlobalSolver::ConjugateGradient) {
+        line << " (" << double(linear) / iterations << " CG iterations each)";
+    }
+    if (!ok || !solver.getPoints().allFinite()) line << ", FAILED";
+    return line.str();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {100, 250, 500, 1000, 2000};
+    if (argc > 1) {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        for (std::string item; std::getline(list, item, ',');) sizes.push_back(std::stoi(item));
+    }
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 10;
+    const unsigned int timeLimit = argc > 3 ? std::stoi(argv[3]) : 600;
+    const rlim_t memoryLimit = argc > 4 ? std::stoul(argv[4]) : 0;
+
+    bool ok = true;
+    for (bool cloth : {true, false}) {
+        ShapeOp::Matrix3X direct, cg;
+        run(64, cloth, methods[0], iterations, &direct);
+        run(64, cloth, methods[1], iterations, &cg);
+        const double deviation = (direct - cg).cwiseAbs().maxCoeff();
+        std::cout << (cloth ? "cloth" : "net") << " 64x64: CG deviates " << deviation << " from direct" << std::endl;
+        ok = ok && deviation < 1e-3;
+    }
+
+    for (bool cloth : {true, false}) {
+        for (int size : sizes) {
+            for (const Method &method : methods) {
+                int pipe[2];
+                if (::pipe(pipe) != 0) return 1;
+                const pid_t child = fork();
+                if (child == 0) {
+                    ::close(pipe[0]);
+                    alarm(timeLimit);
+                    if (memoryLimit > 0) {
+                        const struct rlimit limit = {memoryLimit << 20, memoryLimit << 20};
+                        setrlimit(RLIMIT_AS, &limit);
+                    }
+                    const std::string line = run(size, cloth, method, iterations);
+                    if (::write(pipe[1], line.data(), line.size()) < 0) _exit(1);
+                    _exit(0);
+                }
+                ::close(pipe[1]);
+                std::string line;
+                char buffer[256];
+                for (ssize_t got; (got = ::read(pipe[0], buffer, sizeof(buffer))) > 0;) line.append(buffer, got);
+                ::close(pipe[0]);
+                int status = 0;
+                struct rusage usage = {};
+                wait4(child, &status, 0, &usage);
+                if (WIFSIGNALED(status)) {
+                    line = WTERMSIG(status) == SIGALRM ? "over the time limit" : "out of memory";
+                }
+                std::cout << (cloth ? "cloth " : "net   ") << size << "x" << size << " " << method.name << ": "
+                          << line << ", peak " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+            }
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Per-frame error of a hanging cloth (wind_cloth.cpp in dynamic mode) after a fixed
+// iteration budget per frame, plain versus Chebyshev-accelerated. The error is the
+// objective's gradient after the budget, relative to its value at the start of the frame.
+// Usage: chebyshev_bench [grid size] [frames] [iterations per frame]
+
+struct Run {
+    double meanError = 0.0;
+    double maxError = 0.0;
+    double msPerFrame = 0.0;
+    unsigned int fallbacks = 0;
+    double rho = 0.0;
+};
+
+static Run simulate(int size, int frames, unsigned int budget, bool chebyshev) {
+    ShapeOp::ExtendedSolver solver;
+    solver.setPoints(bench::clothGrid(size, size));
+    bench::addClothConstraints(solver, size, size);
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    solver.initialize(true);
+    solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Residual, 0.0);
+    solver.setChebyshev(chebyshev);
+
+    Run run;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        solver.solve(budget);
+        run.meanError += solver.getResidual() / frames;
+        run.maxError = std::max(run.maxError, static_cast<double>(solver.getResidual()));
+        run.fallbacks += solver.getFallbacks();
+    }
+    run.msPerFrame = bench::elapsedMs(start) / frames;
+    run.rho = solver.getSpectralRadius();
+    return run;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 100;
+    const int frames = argc > 2 ? std::stoi(argv[2]) : 50;
+    const unsigned int budget = argc > 3 ? std::stoi(argv[3]) : 10;
+
+    std::cout << size << "x" << size << " hanging cloth, " << frames << " frames, " << budget
+              << " iterations per frame" << std::endl;
+    for (bool chebyshev : {false, true}) {
+        const Run run = simulate(size, frames, budget, chebyshev);
+        std::cout << (chebyshev ? "chebyshev: " : "plain:     ") << "mean error " << run.meanError << ", max error "
+                  << run.maxError << ", " << run.msPerFrame << " ms/frame";
+        if (chebyshev) {
+            std::cout << ", rho " << run.rho << ", " << run.fallbacks << " fallbacks";
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ContactConstraint.h"
+#include "ExtendedSolver.h"
+#include "MeshIO.h"
+#include "SpatialHash.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+// Contact detection throughput on a sheet folded onto itself, so every vertex of the
+// upper layer is in contact with the lower one: spatial hash rebuild time for the
+// triangles' boxes and full ContactConstraint::detect() time, as queries (one per
+// vertex and one per edge) per second. Checks first that the wind_cloth.cpp scene
+// follows the same trajectory with and without --contact for as long as the cloth
+// doesn't touch itself, and, on the smallest mesh, that the hash returns every
+// triangle a brute-force box test finds, timing that test.
+// Usage: collision_bench [triangle counts, e.g. 10000,100000,1000000] [repetitions]
+
+namespace {
+
+struct Sheet {
+    ShapeOp::Matrix3X points;
+    std::vector<std::vector<int>> faces;
+    double spacing;
+};
+
+// Grid of about triangles / 2 quads on [0, 2] x [0, 1], folded at x = 1 so the right
+// half lies gap above the left half
+Sheet foldedSheet(int triangles, double gapFactor) {
+    const int rows = std::max(2, static_cast<int>(std::sqrt(triangles / 4.0)) + 1);
+    const int cols = 2 * rows - 1;
+    Sheet sheet;
+    sheet.spacing = 1.0 / (rows - 1);
+    sheet.points = bench::clothGrid(rows, cols, sheet.spacing);
+    for (int k = 0; k < sheet.points.cols(); ++k) {
+        if (sheet.points(0, k) > 1.0) {
+            sheet.points(0, k) = 2.0 - sheet.points(0, k);
+            sheet.points(1, k) = gapFactor * sheet.spacing;
+        }
+    }
+    sheet.faces = bench::gridTriangles(rows, cols);
+    return sheet;
+}
+
+void triangleBoxes(const Sheet &sheet, double grow, ShapeOp::Matrix3X &lower, ShapeOp::Matrix3X &upper) {
+    const int n = static_cast<int>(sheet.faces.size());
+    lower.resize(3, n);
+    upper.resize(3, n);
+    for (int t = 0; t < n; ++t) {
+        const auto &f = sheet.faces[t];
+        const ShapeOp::Vector3 &a = sheet.points.col(f[0]), &b = sheet.points.col(f[1]), &c = sheet.points.col(f[2]);
+        lower.col(t) = a.cwiseMin(b).cwiseMin(c).array() - grow;
+        upper.col(t) = a.cwiseMax(b).cwiseMax(c).array() + grow;
+    }
+}
+
+// wind_cloth.cpp, with or without its contact constraint
+std::shared_ptr<ShapeOp::ContactConstraint> windCloth(ShapeOp::ExtendedSolver &solver, int size, bool contact) {
+    solver.setPoints(bench::clothGrid(size, size));
+    bench::addClothConstraints(solver, size, size);
+    std::shared_ptr<ShapeOp::ContactConstraint> constraint;
+    if (contact) {
+        constraint = std::make_shared<ShapeOp::ContactConstraint>(
+            ShapeOp::gridMesh(solver.getPoints(), size, size).faceList(), 1.0, solver.getPoints(), 0.25);
+        solver.addConstraint(constraint);
+    }
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    solver.initialize(true);
+    return constraint;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {10000, 100000, 1000000};
+    if (argc > 1) {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        for (std::string item; std::getline(list, item, ',');) sizes.push_back(std::stoi(item));
+    }
+    const int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+    int threads = 1;
+#ifdef SHAPEOP_OPENMP
+    threads = omp_get_max_threads();
+#endif
+    std::cout << threads << " thread(s), thickness half the edge length, layers a quarter edge apart" << std::endl;
+
+    // Contact rows without contacts must not change the solve: step both clothes until
+    // the first step that ran with contacts
+    bool ok = true;
+    {
+        ShapeOp::ExtendedSolver plain, touching;
+        windCloth(plain, 20, false);
+        const auto contact = windCloth(touching, 20, true);
+        int steps = 0;
+        for (; steps < 500; ++steps) {
+            plain.solve(1);
+            touching.solve(1);
+            const auto counts = contact->getCounts();
+            if (counts.vertexTriangle + counts.edgeEdge + counts.obstacle > 0) {
+                break;
+            }
+            if (plain.getPoints() != touching.getPoints()) {
+                std::cout << "wind_cloth: trajectory with contact differs at step " << steps << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        std::cout << "wind_cloth: same trajectory with and without contact for " << steps << " steps" << std::endl;
+        ok = ok && steps > 0;
+    }
+
+    // Broad phase against brute force on the smallest mesh
+    {
+        const Sheet sheet = foldedSheet(sizes.front(), 0.25);
+        const double thickness = 0.5 * sheet.spacing;
+        ShapeOp::Matrix3X lower, upper;
+        triangleBoxes(sheet, thickness, lower, upper);
+        ShapeOp::SpatialHash hash(sheet.spacing + thickness);
+        hash.build(lower, upper);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<int>> brute(sheet.points.cols());
+        for (int v = 0; v < sheet.points.cols(); ++v) {
+            const ShapeOp::Vector3 &p = sheet.points.col(v);
+            for (int t = 0; t < lower.cols(); ++t) {
+                if ((p.array() >= lower.col(t).array()).all() && (p.array() <= upper.col(t).array()).all()) {
+                    brute[v].push_back(t);
+                }
+            }
+        }
+        const double bruteMs = bench::elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<int> candidates;
+        std::size_t missed = 0, found = 0, returned = 0;
+        for (int v = 0; v < sheet.points.cols(); ++v) {
+            candidates.clear();
+            hash.query(sheet.points.col(v), sheet.points.col(v), candidates);
+            returned += candidates.size();
+            for (int t : brute[v]) {
+                ++found;
+                missed += !std::binary_search(candidates.begin(), candidates.end(), t);
+            }
+        }
+        const double hashMs = bench::elapsedMs(start);
+        std::cout << sheet.faces.size() << " triangles: brute force " << bruteMs << " ms, hash queries " << hashMs
+                  << " ms, " << found << " overlaps, " << missed << " missed, " << returned
+                  << " candidates returned" << std::endl;
+        ok = ok && missed == 0;
+    }
+
+    for (int size : sizes) {
+        const Sheet sheet = foldedSheet(size, 0.25);
+        const double thickness = 0.5 * sheet.spacing;
+
+        ShapeOp::Matrix3X lower, upper;
+        triangleBoxes(sheet, thickness, lower, upper);
+        ShapeOp::SpatialHash hash(sheet.spacing + thickness);
+        hash.build(lower, upper);
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) hash.build(lower, upper);
+        const double rebuildMs = bench::elapsedMs(start) / repetitions;
+
+        ShapeOp::ContactConstraint contact(sheet.faces, 1.0, sheet.points, thickness);
+        contact.detect(sheet.points);
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repetitions; ++r) contact.detect(sheet.points);
+        const double detectMs = bench::elapsedMs(start) / repetitions;
+
+        const auto counts = contact.getCounts();
+        const double queries = double(sheet.points.cols()) + contact.nEdges();
+        std::cout << contact.nTriangles() << " triangles, " << sheet.points.cols() << " vertices: rebuild "
+                  << rebuildMs << " ms (" << hash.nEntries() << " entries), detect " << detectMs << " ms, "
+                  << queries / (detectMs * 1e-3) << " queries/s, " << counts.vertexTriangle
+                  << " vertex-triangle and " << counts.edgeEdge << " edge-edge contacts" << std::endl;
+    }
+    return ok ? 0 : 1;
+}
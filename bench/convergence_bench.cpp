@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "EnsembleRunner.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Fixed iteration budget versus tolerance-based stopping on a batch of
+// unary_force.cpp style nets (static, pinned corners and center, gravity) from
+// 10x10 to 50x50: iterations used, wall time and the largest deviation of the
+// final points from the full-budget run.
+// Usage: convergence_bench [problems] [max iterations]
+
+static Eigen::Matrix2Xi gridEdges(int size) {
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (x + 1 < size) edges.col(e++) << y * size + x, y * size + x + 1;
+            if (y + 1 < size) edges.col(e++) << y * size + x, (y + 1) * size + x;
+        }
+    }
+    return edges;
+}
+
+static std::vector<ShapeOp::EnsembleProblem> makeProblems(int count, unsigned int iterations,
+                                                          ShapeOp::ExtendedSolver::StopCriterion criterion,
+                                                          ShapeOp::Scalar tolerance) {
+    std::vector<ShapeOp::EnsembleProblem> problems(count);
+    for (int k = 0; k < count; ++k) {
+        const int size = 10 + (k * 7) % 41;
+        problems[k].iterations = iterations;
+        problems[k].criterion = criterion;
+        problems[k].tolerance = tolerance;
+        problems[k].build = [size](ShapeOp::ExtendedSolver &solver, std::pmr::memory_resource *resource) {
+            solver.setPoints(bench::clothGrid(size, size));
+            ShapeOp::ConstraintBuilder builder(solver.getPoints(), resource);
+            std::vector<std::shared_ptr<ShapeOp::Constraint>> constraints;
+
+            Eigen::VectorXi pins(5);
+            pins << 0, size - 1, size * (size - 1), size * size - 1, (size / 2) * size + size / 2;
+            builder.closeness(pins, 1e5, constraints);
+            builder.edgeStrain(gridEdges(size), 1.0, 1.0, 1.0, constraints);
+            ShapeOp::addConstraints(solver, constraints);
+            solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, 0.001, 0.0)));
+        };
+    }
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    using Criterion = ShapeOp::ExtendedSolver::StopCriterion;
+    const int count = argc > 1 ? std::stoi(argv[1]) : 100;
+    const unsigned int budget = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+    ShapeOp::EnsembleRunner runner;
+    std::cout << count << " problems, budget " << budget << " iterations, " << runner.threads() << " thread(s)"
+              << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    const auto reference = runner.run(makeProblems(count, budget, Criterion::None, 0.0));
+    const double referenceMs = bench::elapsedMs(start);
+    std::cout << "fixed:        " << budget << " iterations/problem, " << referenceMs << " ms" << std::endl;
+
+    const std::vector<std::pair<std::string, std::pair<Criterion, double>>> runs = {
+        {"energy       ", {Criterion::Energy, 1e-5}},
+        {"displacement ", {Criterion::Displacement, 1e-4}},
+        {"residual     ", {Criterion::Residual, 1e-2}},
+    };
+    for (const auto &run : runs) {
+        start = std::chrono::steady_clock::now();
+        const auto results = runner.run(makeProblems(count, budget, run.second.first, run.second.second));
+        const double ms = bench::elapsedMs(start);
+
+        double iterations = 0.0, deviation = 0.0;
+        for (int k = 0; k < count; ++k) {
+            iterations += results[k].iterations;
+            deviation = std::max<double>(deviation, (results[k].points - reference[k].points).cwiseAbs().maxCoeff());
+        }
+        std::cout << run.first << run.second.second << ": " << iterations / count << " iterations/problem, " << ms
+                  << " ms (" << referenceMs / ms << "x), max deviation " << deviation << std::endl;
+    }
+
+    return 0;
+}
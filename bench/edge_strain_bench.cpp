@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "EdgeStrainBlock.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Local step cost of N individual EdgeStrainConstraints versus one EdgeStrainBlock
+// on a cable-net style grid (horizontal then vertical edges).
+// Usage: edge_strain_bench [grid size] [iterations]
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 250;
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    ShapeOp::Matrix3X points = bench::clothGrid(size, size);
+    auto index = [size](int x, int y) { return y * size + x; };
+
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size - 1; ++x) {
+            edges.col(e++) << index(x, y), index(x + 1, y);
+        }
+    }
+    for (int y = 0; y < size - 1; ++y) {
+        for (int x = 0; x < size; ++x) {
+            edges.col(e++) << index(x, y), index(x, y + 1);
+        }
+    }
+
+    // Individual constraints, as the example drivers build them
+    std::vector<std::shared_ptr<ShapeOp::Constraint>> constraints;
+    std::vector<ShapeOp::Triplet> triplets;
+    int idO = 0;
+    for (int k = 0; k < edges.cols(); ++k) {
+        constraints.push_back(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+            std::vector<int>{edges(0, k), edges(1, k)}, 100.0, points, 0.45, 0.55));
+        constraints.back()->addConstraint(triplets, idO);
+    }
+
+    ShapeOp::EdgeStrainBlock block(edges, 100.0, points, 0.45, 0.55);
+    std::vector<ShapeOp::Triplet> blockTriplets;
+    int blockIdO = 0;
+    block.addConstraint(blockTriplets, blockIdO);
+
+    // Perturb the grid so some edges stretch and some compress
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+    for (int i = 0; i < points.cols(); ++i) {
+        points.col(i) += ShapeOp::Vector3(jitter(rng), jitter(rng), jitter(rng));
+    }
+
+    std::cout << size << "x" << size << " grid, " << edges.cols() << " edges, " << iterations << " iterations"
+              << std::endl;
+
+    ShapeOp::Matrix3X individual = ShapeOp::Matrix3X::Zero(3, idO);
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (const auto &c : constraints) {
+            c->project(points, individual);
+        }
+    }
+    double individualMs = bench::elapsedMs(start) / iterations;
+
+    ShapeOp::Matrix3X packed = ShapeOp::Matrix3X::Zero(3, blockIdO);
+    start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        block.project(points, packed);
+    }
+    double packedMs = bench::elapsedMs(start) / iterations;
+
+    double tripletDiff = 0.0;
+    for (size_t t = 0; t < triplets.size(); ++t) {
+        tripletDiff = std::max<double>(tripletDiff, std::abs(triplets[t].value() - blockTriplets[t].value()));
+    }
+
+    std::cout << "individual constraints: " << individualMs << " ms/local step" << std::endl;
+    std::cout << "edge strain block:      " << packedMs << " ms/local step (" << individualMs / packedMs << "x)"
+              << std::endl;
+    std::cout << "max projection difference: " << (individual - packed).cwiseAbs().maxCoeff() << std::endl;
+    std::cout << "max matrix difference:     " << tripletDiff << std::endl;
+
+    return 0;
+}
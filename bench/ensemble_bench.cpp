@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "EnsembleRunner.h"
+#include "NormalForce.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of many small independent problems: unary_force.cpp and balloon.cpp style
+// nets from 10x10 to 50x50, solved on one thread and on every core with EnsembleRunner.
+// Also checks that results match between the two and that cancel() stops a run early.
+// Usage: ensemble_bench [problems] [steps] [threads]
+
+static Eigen::Matrix2Xi gridEdges(int size) {
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (x + 1 < size) edges.col(e++) << y * size + x, y * size + x + 1;
+            if (y + 1 < size) edges.col(e++) << y * size + x, (y + 1) * size + x;
+        }
+    }
+    return edges;
+}
+
+static std::vector<ShapeOp::EnsembleProblem> makeProblems(int count, unsigned int steps) {
+    std::vector<ShapeOp::EnsembleProblem> problems(count);
+    for (int k = 0; k < count; ++k) {
+        const int size = 10 + (k * 7) % 41;
+        const bool balloon = k % 2 == 1;
+        problems[k].steps = steps;
+        problems[k].build = [size, balloon](ShapeOp::ExtendedSolver &solver, std::pmr::memory_resource *resource) {
+            solver.setPoints(bench::clothGrid(size, size, 2.0 / (size - 1)));
+            ShapeOp::ConstraintBuilder builder(solver.getPoints(), resource);
+            std::vector<std::shared_ptr<ShapeOp::Constraint>> constraints;
+
+            Eigen::VectorXi pins(5);
+            pins << 0, size - 1, size * (size - 1), size * size - 1, (size / 2) * size + size / 2;
+            builder.closeness(balloon ? pins.head(4) : pins, 1e5, constraints);
+            builder.edgeStrain(gridEdges(size), 1.0, 1.0, 1.0, constraints);
+            ShapeOp::addConstraints(solver, constraints);
+
+            if (balloon) {
+                solver.addForces(std::make_shared<ShapeOp::NormalForce>(bench::gridTriangles(size, size), 0.5));
+            } else {
+                solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, 0.001, 0.0)));
+            }
+        };
+    }
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    const int count = argc > 1 ? std::stoi(argv[1]) : 500;
+    const unsigned int steps = argc > 2 ? std::stoi(argv[2]) : 100;
+    const int threads = argc > 3 ? std::stoi(argv[3]) : 0;
+    const auto problems = makeProblems(count, steps);
+
+    ShapeOp::EnsembleRunner serial(1);
+    auto start = std::chrono::steady_clock::now();
+    const auto reference = serial.run(problems);
+    std::cout << count << " problems, " << steps << " steps each" << std::endl;
+    std::cout << "1 thread: " << bench::elapsedMs(start) << " ms, " << serial.problemsPerSecond() << " problems/s"
+              << std::endl;
+
+    ShapeOp::EnsembleRunner runner(threads);
+    start = std::chrono::steady_clock::now();
+    const auto results = runner.run(problems);
+    std::cout << runner.threads() << " threads: " << bench::elapsedMs(start) << " ms, "
+              << runner.problemsPerSecond() << " problems/s, speedup "
+              << runner.problemsPerSecond() / serial.problemsPerSecond() << "x" << std::endl;
+
+    int mismatches = 0;
+    for (int k = 0; k < count; ++k) {
+        if (results[k].status != ShapeOp::EnsembleResult::Status::Solved || results[k].points != reference[k].points) {
+            ++mismatches;
+        }
+    }
+    std::cout << "results differing from the serial run: " << mismatches << std::endl;
+
+    // Cancel a quarter of the way through
+    std::thread canceller([&runner, count] {
+        while (runner.completed() < static_cast<std::size_t>(count / 4)) std::this_thread::yield();
+        runner.cancel();
+    });
+    const auto partial = runner.run(problems);
+    canceller.join();
+    int solved = 0;
+    for (const auto &r : partial) solved += r.status == ShapeOp::EnsembleResult::Status::Solved;
+    std::cout << "cancelled run: " << solved << " solved, " << count - solved << " cancelled" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "BatchForce.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include "NormalForce.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Per-vertex get() loop versus one batched addForces() call per force on a
+// wind_cloth grid with gravity, a vertex force and a normal force.
+// Usage: force_bench [grid size] [iterations]
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 200;
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    ShapeOp::Matrix3X points = bench::clothGrid(size, size);
+    std::vector<std::shared_ptr<ShapeOp::Force>> forces = {
+        std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)),
+        std::make_shared<ShapeOp::VertexForce>(ShapeOp::Vector3(0.0, 0.0, 1.0), size / 2),
+        std::make_shared<ShapeOp::NormalForce>(bench::gridTriangles(size, size), 0.1),
+    };
+    std::cout << size << "x" << size << " grid, " << points.cols() << " vertices, " << iterations << " iterations"
+              << std::endl;
+
+    // Force evaluation alone
+    ShapeOp::Matrix3X perVertex(3, points.cols());
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        perVertex.setZero();
+        for (int i = 0; i < points.cols(); ++i) {
+            for (const auto &f : forces) {
+                perVertex.col(i) += f->get(points, i);
+            }
+        }
+    }
+    double perVertexMs = bench::elapsedMs(start) / iterations;
+
+    ShapeOp::Matrix3X batched(3, points.cols());
+    start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        batched.setZero();
+        for (const auto &f : forces) {
+            ShapeOp::addForces(*f, points, batched);
+        }
+    }
+    double batchedMs = bench::elapsedMs(start) / iterations;
+
+    std::cout << "forces only, per-vertex: " << perVertexMs << " ms/iteration" << std::endl;
+    std::cout << "forces only, batched:    " << batchedMs << " ms/iteration (" << perVertexMs / batchedMs << "x)"
+              << std::endl;
+    std::cout << "max difference: " << (perVertex - batched).cwiseAbs().maxCoeff() << std::endl;
+
+    // Whole static solve, where forces are evaluated every iteration
+    for (bool batchedForces : {false, true}) {
+        ShapeOp::ExtendedSolver solver;
+        solver.setPoints(points);
+        bench::addClothConstraints(solver, size, size);
+        for (const auto &f : forces) {
+            solver.addForces(f);
+        }
+        solver.setBatchedForces(batchedForces);
+        solver.initialize(false);
+
+        start = std::chrono::steady_clock::now();
+        solver.solve(iterations);
+        std::cout << "solve, " << (batchedForces ? "batched:    " : "per-vertex: ") << bench::elapsedMs(start) / iterations
+                  << " ms/iteration" << std::endl;
+    }
+
+    return 0;
+}
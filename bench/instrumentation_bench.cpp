@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Solver statistics for the balloon box and a cable net, and the cost of collecting
+// them: the same solve with instrumentation off, on, and on with tracing, checking the
+// points come out identical. Compare the "off" times against a build without
+// SHAPEOP_INSTRUMENTATION for the cost of having it compiled in.
+// Usage: instrumentation_bench [iterations] [trace file]
+
+static void printStats(const ShapeOp::SolverStats &stats) {
+    const std::pair<const char *, const ShapeOp::PhaseStats *> phases[] = {
+        {"initialize", &stats.initialize}, {"analyze", &stats.analyze},
+        {"factorize", &stats.factorize},   {"localStep", &stats.localStep},
+        {"collisions", &stats.collisions}, {"rhs", &stats.rhs},
+        {"forces", &stats.forces},         {"globalStep", &stats.globalStep},
+        {"acceleration", &stats.acceleration}, {"convergence", &stats.convergence},
+    };
+    std::cout << "  " << stats.solves << " solves, " << stats.iterations << " iterations" << std::endl;
+    for (const auto &[name, phase] : phases) {
+        if (phase->calls == 0) continue;
+        std::cout << "  " << std::setw(14) << std::left << name << std::right << std::setw(10)
+                  << phase->seconds * 1e3 << " ms " << std::setw(8) << phase->calls << " calls" << std::endl;
+    }
+    for (const auto &type : stats.constraintTypes) {
+        std::cout << "  " << type.name << ": " << type.projections << " projections, " << type.seconds * 1e3
+                  << " ms" << std::endl;
+    }
+    for (const auto &force : stats.perForce) {
+        std::cout << "  " << force.name << ": " << force.calls << " calls, " << force.seconds * 1e3 << " ms"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    const int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+    const std::string traceFile = argc > 2 ? argv[2] : "instrumentation_bench.json";
+#ifdef SHAPEOP_INSTRUMENTATION
+    std::cout << "SHAPEOP_INSTRUMENTATION on" << std::endl;
+#else
+    std::cout << "SHAPEOP_INSTRUMENTATION off: no statistics, only the solve times" << std::endl;
+#endif
+
+    struct Case {
+        const char *name;
+        void (*build)(ShapeOp::ExtendedSolver &);
+    };
+    const Case cases[] = {
+        {"balloon box", [](ShapeOp::ExtendedSolver &solver) { bench::balloonBox(solver, 24); }},
+        {"cable net", [](ShapeOp::ExtendedSolver &solver) { bench::cableNet(solver, 128); }},
+    };
+
+    bool ok = true;
+    for (const Case &c : cases) {
+        std::cout << c.name << ", " << iterations << " iterations" << std::endl;
+        ShapeOp::Matrix3X reference;
+        for (int mode = 0; mode < 3; ++mode) {
+            const bool enabled = mode > 0, trace = mode == 2;
+
+            // Best of three, one solve() call of all iterations each
+            double best = 0.0;
+            for (int run = 0; run < 3; ++run) {
+                ShapeOp::ExtendedSolver solver;
+                solver.setInstrumentation(enabled, trace);
+                c.build(solver);
+                solver.initialize();
+                auto start = std::chrono::steady_clock::now();
+                solver.solve(iterations);
+                const double ms = bench::elapsedMs(start);
+                best = run == 0 ? ms : std::min(best, ms);
+                if (run > 0) continue;
+
+                if (mode == 0) {
+                    reference = solver.getPoints();
+                } else {
+                    ok = ok && solver.getPoints() == reference;
+                }
+                if (mode == 1) {
+                    printStats(solver.getStats());
+                }
+                if (trace && &c == &cases[0]) {
+                    solver.writeTrace(traceFile);
+                }
+            }
+            std::cout << (mode == 0 ? "  off: " : trace ? "  trace: " : "  on: ") << best << " ms, "
+                      << best * 1e3 / iterations << " us/iteration" << std::endl;
+        }
+    }
+    std::cout << "trace of the balloon box written to " << traceFile << std::endl;
+    std::cout << (ok ? "results identical" : "MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "ExtendedSolver.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+// Strong scaling of the parallel local step on a wind_cloth grid, with the
+// example drivers' individual constraints or one packed EdgeStrainBlock.
+// Build with -DSHAPEOP_OPENMP=ON; each thread count's solve() result is compared
+// bit for bit against the single-threaded one.
+// Usage: local_step_bench [grid size] [iterations] [individual|packed]
+
+static Eigen::Matrix2Xi gridEdges(int size) {
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size - 1; ++x) {
+            edges.col(e++) << y * size + x, y * size + x + 1;
+        }
+    }
+    for (int y = 0; y < size - 1; ++y) {
+        for (int x = 0; x < size; ++x) {
+            edges.col(e++) << y * size + x, (y + 1) * size + x;
+        }
+    }
+    return edges;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 500;
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 20;
+    const std::string mode = argc > 3 ? argv[3] : "individual";
+
+    const ShapeOp::Matrix3X points = bench::clothGrid(size, size);
+    ShapeOp::ExtendedSolver solver;
+    solver.setPoints(points);
+    if (mode == "packed") {
+        for (int id : {0, size * size - 1}) {
+            solver.addConstraint(std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{id}, 1e5, points));
+        }
+        ShapeOp::ConstraintBuilder builder(solver.getPoints());
+        solver.addConstraint(builder.edgeStrainBlock(gridEdges(size), 10.0, 0.8, 1.2));
+    } else {
+        bench::addClothConstraints(solver, size, size);
+    }
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    solver.initialize();
+    std::cout << size << "x" << size << " grid, " << mode << " constraints, " << iterations << " iterations"
+              << std::endl;
+
+#ifndef SHAPEOP_OPENMP
+    std::cout << "built without SHAPEOP_OPENMP, serial only" << std::endl;
+    const std::vector<int> threadCounts = {1};
+#else
+    const std::vector<int> threadCounts = {1, 2, 4, 8, 16};
+#endif
+
+    ShapeOp::Matrix3X serial;
+    double serialMs = 0.0;
+    for (int threads : threadCounts) {
+#ifdef SHAPEOP_OPENMP
+        omp_set_num_threads(threads);
+#endif
+        solver.setPoints(points);
+        solver.solve(5);
+        const ShapeOp::Matrix3X result = solver.getPoints();
+        if (threads == 1) serial = result;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; ++it) {
+            solver.projectConstraints();
+        }
+        const double ms = bench::elapsedMs(start) / iterations;
+        if (threads == 1) serialMs = ms;
+
+        std::cout << threads << " thread(s): local step " << ms << " ms, speedup " << serialMs / ms << "x, "
+                  << (result == serial ? "bit-identical" : "DIFFERENT") << std::endl;
+    }
+
+    return 0;
+}
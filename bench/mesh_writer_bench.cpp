@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "MeshIO.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Write throughput for a quad grid of about 1M vertices: the examples' old
+// ofstream << std::endl output, writeOBJ and binary writePLY, on one and on all threads.
+// The OBJ is read back with loadOBJ and the PLY vertex block compared byte for byte.
+// Usage: mesh_writer_bench [grid size] [file] [threads]
+
+// How the examples used to write their results
+static void streamOBJ(const std::string &filename, const ShapeOp::Mesh &mesh) {
+    std::ofstream objFile(filename);
+    for (int i = 0; i < mesh.points.cols(); ++i) {
+        objFile << "v " << mesh.points(0, i) << " " << mesh.points(1, i) << " " << mesh.points(2, i) << std::endl;
+    }
+    for (int f = 0; f < mesh.nFaces(); ++f) {
+        objFile << "f";
+        for (int c = mesh.faceOffsets[f]; c < mesh.faceOffsets[f + 1]; ++c) {
+            objFile << " " << mesh.faceIndices[c] + 1;
+        }
+        objFile << std::endl;
+    }
+}
+
+static double fileMegabytes(const std::string &filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    return file.tellg() / 1e6;
+}
+
+template <typename Write>
+static void report(const std::string &label, const std::string &filename, Write &&write) {
+    auto start = std::chrono::steady_clock::now();
+    write();
+    const double ms = bench::elapsedMs(start);
+    const double megabytes = fileMegabytes(filename);
+    std::cout << label << ": " << ms << " ms, " << megabytes << " MB, " << megabytes / ms * 1e3 << " MB/s"
+              << std::endl;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 1000;
+    const std::string filename = argc > 2 ? argv[2] : "mesh_writer_bench";
+    const int threads =
+        argc > 3 ? std::stoi(argv[3]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const std::string obj = filename + ".obj", ply = filename + ".ply";
+
+    ShapeOp::Matrix3X points = bench::clothGrid(size, size, 1.0 / (size - 1));
+    for (int i = 0; i < points.cols(); ++i) {
+        points(2, i) = 0.1 * std::sin(0.37 * points(0, i) * size) * std::cos(0.21 * points(1, i) * size);
+    }
+    const ShapeOp::Mesh mesh = ShapeOp::gridMesh(points, size, size);
+    std::cout << size << "x" << size << " grid: " << points.cols() << " vertices, " << mesh.nFaces() << " quads"
+              << std::endl;
+
+    report("ofstream << std::endl", obj, [&] { streamOBJ(obj, mesh); });
+    std::vector<int> counts = threads > 1 ? std::vector<int>{1, threads} : std::vector<int>{1};
+    for (int t : counts) {
+        report("writeOBJ, " + std::to_string(t) + " thread(s)", obj, [&] { ShapeOp::writeOBJ(obj, mesh, "", t); });
+    }
+    for (int t : counts) {
+        report("writePLY, " + std::to_string(t) + " thread(s)", ply, [&] { ShapeOp::writePLY(ply, mesh, t); });
+    }
+
+    ShapeOp::Mesh loaded = ShapeOp::loadOBJ(obj);
+    bool ok = loaded.points == mesh.points && loaded.faceOffsets == mesh.faceOffsets &&
+              loaded.faceIndices == mesh.faceIndices;
+
+    std::ifstream plyFile(ply, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(plyFile)), std::istreambuf_iterator<char>());
+    const size_t header = bytes.find("end_header\n") + std::strlen("end_header\n");
+    const size_t vertexBytes = sizeof(ShapeOp::Scalar) * mesh.points.size();
+    const size_t faceBytes = mesh.nFaces() + sizeof(int) * mesh.faceIndices.size();
+    ok = ok && bytes.size() == header + vertexBytes + faceBytes &&
+         std::memcmp(bytes.data() + header, mesh.points.data(), vertexBytes) == 0;
+    std::cout << (ok ? "round trip exact" : "MISMATCH") << std::endl;
+
+    std::remove(obj.c_str());
+    std::remove(ply.c_str());
+    return ok ? 0 : 1;
+}
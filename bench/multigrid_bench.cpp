@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "ExtendedSolver.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Time to tolerance of the hierarchical solve (ExtendedSolver::setHierarchy) against the
+// single-level local/global iteration, for static equilibria of growing grids: a
+// triangulated cloth hanging from two corners and the cable net. Geometric (grid) and
+// algebraic (aggregation) coarsening are timed separately; initialize() time is
+// included, since the hierarchy is built there. The residual criterion is relative to
+// the first iteration, so each method solves from the rest pose with doubling iteration
+// (cycle) counts until it reaches the tolerance or its time budget runs out.
+// The net's first iteration does most of the work, so it gets a tighter tolerance.
+// Usage: multigrid_bench [sizes, e.g. 64,128,256,512] [cloth tolerance] [net tolerance]
+//                        [budget in s per method]
+
+namespace {
+
+enum class Mode { Single, Grid, Aggregation };
+
+void buildScene(ShapeOp::ExtendedSolver &solver, int size, bool cloth) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    solver.setPoints(bench::clothGrid(size, size, 1.0 / (size - 1)));
+    Eigen::Matrix2Xi edges(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (x + 1 < size) edges.col(e++) << index(x, y), index(x + 1, y);
+            if (y + 1 < size) edges.col(e++) << index(x, y), index(x, y + 1);
+        }
+    }
+    ShapeOp::ConstraintBuilder builder(solver.getPoints());
+    if (cloth) {
+        edges = ShapeOp::ConstraintBuilder::uniqueEdges(bench::gridTriangles(size, size));
+        solver.addConstraint(builder.edgeStrainBlock(edges, 10.0, 0.8, 1.2));
+        solver.fixVertex(index(0, 0));
+        solver.fixVertex(index(size - 1, 0));
+        solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -1e-3, 0.0)));
+    } else {
+        solver.addConstraint(builder.edgeStrainBlock(edges, 100.0, 0.45, 0.55));
+        const ShapeOp::Vector3 lift(0.0, 1.0, 0.0);
+        solver.fixVertex(index(0, 0), solver.getPoints().col(index(0, 0)) + lift);
+        solver.fixVertex(index(size - 1, size - 1), solver.getPoints().col(index(size - 1, size - 1)) + lift);
+        solver.fixVertex(index(size - 1, 0));
+        solver.fixVertex(index(0, size - 1));
+    }
+}
+
+struct Result {
+    double ms = 0.0;
+    unsigned int iterations = 0;
+    double residual = 0.0;
+    int levels = 1;
+    ShapeOp::Matrix3X points;
+};
+
+Result run(int size, bool cloth, Mode mode, double tolerance, double budgetMs) {
+    ShapeOp::ExtendedSolver solver;
+    buildScene(solver, size, cloth);
+    if (mode == Mode::Grid) {
+        solver.setHierarchy(8, size, size);
+    } else if (mode == Mode::Aggregation) {
+        solver.setHierarchy(8);
+    }
+    solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Residual, tolerance);
+
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+    solver.initialize();
+    const double initializeMs = bench::elapsedMs(start);
+    result.levels = solver.getLevels();
+
+    const ShapeOp::Matrix3X rest = solver.getPoints();
+    double spentMs = initializeMs;
+    for (unsigned int iterations = 1;; iterations *= 2) {
+        solver.setPoints(rest);
+        start = std::chrono::steady_clock::now();
+        solver.solve(iterations);
+        const double solveMs = bench::elapsedMs(start);
+        spentMs += solveMs;
+        result.ms = initializeMs + solveMs;
+        result.iterations = solver.getIterations();
+        result.residual = solver.getResidual();
+        result.points = solver.getPoints();
+        if (result.residual <= tolerance || spentMs + 2.0 * solveMs > budgetMs) break;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {64, 128, 256, 512};
+    if (argc > 1) {
+        sizes.clear();
+        std::stringstream list(argv[1]);
+        for (std::string item; std::getline(list, item, ',');) sizes.push_back(std::stoi(item));
+    }
+    const double tolerances[2] = {argc > 3 ? std::stod(argv[3]) : 1e-4, argc > 2 ? std::stod(argv[2]) : 0.5};
+    const double budgetMs = (argc > 4 ? std::stod(argv[4]) : 120.0) * 1e3;
+
+    for (bool cloth : {true, false}) {
+        const double tolerance = tolerances[cloth];
+        std::cout << (cloth ? "cloth" : "net") << ", relative residual tolerance " << tolerance << std::endl;
+        for (int size : sizes) {
+            const Result single = run(size, cloth, Mode::Single, tolerance, budgetMs);
+            const Result grid = run(size, cloth, Mode::Grid, tolerance, budgetMs);
+            const Result aggregation = run(size, cloth, Mode::Aggregation, tolerance, budgetMs);
+            std::cout << (cloth ? "cloth " : "net   ") << size << "x" << size << std::endl;
+            for (const auto &r : {std::make_pair("single level", &single), std::make_pair("grid", &grid),
+                                  std::make_pair("aggregation", &aggregation)}) {
+                std::cout << "  " << r.first << ": " << r.second->levels << " levels, " << r.second->ms << " ms, "
+                          << r.second->iterations << (r.first == std::string("single level") ? " iterations" : " cycles")
+                          << ", residual " << r.second->residual
+                          << (r.second->residual <= tolerance ? "" : " (budget ran out)");
+                if (r.second != &single) {
+                    std::cout << ", max difference to single level "
+                              << (r.second->points - single.points).cwiseAbs().maxCoeff();
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+    return 0;
+}
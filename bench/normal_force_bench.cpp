@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "MeshIO.h"
+#include "NormalForce.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares NormalForce::Mode::Scan against Mode::Incidence on the balloon_box mesh.
+// Usage: normal_force_bench [mesh.obj] [iterations]
+
+// Evaluates the force on every vertex for a number of sweeps, nudging the
+// positions in between the way a solver iteration would.
+static double run(const ShapeOp::NormalForce &force, ShapeOp::Matrix3X positions, int iterations, ShapeOp::Matrix3X &result) {
+    result.resize(3, positions.cols());
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < iterations; ++it) {
+        for (int i = 0; i < positions.cols(); ++i) {
+            result.col(i) = force.get(positions, i);
+        }
+        positions += 1e-3 * result;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    const std::string objFilePath = argc > 1 ? argv[1] : "data/m0.obj";
+    const int iterations = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    ShapeOp::Matrix3X points;
+    std::vector<std::vector<int>> faces;
+    try {
+        ShapeOp::Mesh mesh = ShapeOp::loadOBJ(objFilePath);
+        points = std::move(mesh.points);
+        faces = mesh.faceList();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << objFilePath << ": " << points.cols() << " vertices, " << faces.size() << " faces, "
+              << iterations << " sweeps" << std::endl;
+
+    auto setupStart = std::chrono::steady_clock::now();
+    ShapeOp::NormalForce incidence(faces, 0.1, ShapeOp::NormalForce::Mode::Incidence);
+    auto setupEnd = std::chrono::steady_clock::now();
+    ShapeOp::NormalForce scan(faces, 0.1, ShapeOp::NormalForce::Mode::Scan);
+
+    ShapeOp::Matrix3X scanResult, incidenceResult;
+    double scanMs = run(scan, points, iterations, scanResult);
+    double incidenceMs = run(incidence, points, iterations, incidenceResult);
+
+    std::cout << "incidence table build: "
+              << std::chrono::duration<double, std::milli>(setupEnd - setupStart).count() << " ms" << std::endl;
+    std::cout << "scan:      " << scanMs << " ms/sweep" << std::endl;
+    std::cout << "incidence: " << incidenceMs << " ms/sweep" << std::endl;
+    std::cout << "speedup:   " << scanMs / incidenceMs << "x" << std::endl;
+    std::cout << "max difference: " << (scanResult - incidenceResult).cwiseAbs().maxCoeff() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "MeshIO.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads a generated OBJ of about 5M vertices (a triangulated grid, with vt and vn
+// statements and v/vt/vn face corners) with the getline/istringstream reader
+// balloon_box.cpp used before and with loadOBJ on one and on all threads.
+// A second file with negative face indices checks those resolve to the same mesh.
+// Usage: obj_loader_bench [grid size] [file] [threads]
+
+// The reader balloon_box.cpp used to have, kept as the baseline
+static void readOBJ(const std::string &filename, ShapeOp::Matrix3X &points, std::vector<std::vector<int>> &faces) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open OBJ file: " + filename);
+    }
+
+    std::vector<ShapeOp::Vector3> vertices;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string prefix;
+        iss >> prefix;
+
+        if (prefix == "v") {
+            double x, y, z;
+            iss >> x >> y >> z;
+            vertices.emplace_back(x, y, z);
+        } else if (prefix == "f") {
+            std::vector<int> face;
+            std::string vertex;
+            while (iss >> vertex) {
+                size_t pos = vertex.find('/');
+                face.push_back(std::stoi(vertex.substr(0, pos)) - 1);
+            }
+            faces.push_back(face);
+        }
+    }
+
+    points.resize(3, vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        points.col(i) = vertices[i];
+    }
+}
+
+// One row of vertices at a time, each followed by the faces of the row below it, so
+// negative indices stay small the way exporters write them
+static void writeGrid(const std::string &filename, int size, bool relative) {
+    std::ofstream file(filename);
+    file.precision(9);
+    const ShapeOp::Matrix3X points = bench::clothGrid(size, size, 1.0 / (size - 1));
+    file << "# " << size << "x" << size << " grid\n";
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const int i = y * size + x;
+            ShapeOp::Scalar z = 0.1 * std::sin(0.01 * x) * std::cos(0.01 * y);
+            file << "v " << points(0, i) << " " << points(1, i) << " " << z << "\n";
+            file << "vt " << x / (size - 1.0) << " " << y / (size - 1.0) << "\n";
+            file << "vn 0 0 1\n";
+        }
+        if (y == 0) continue;
+        for (int x = 0; x + 1 < size; ++x) {
+            // 1-based corners of the quad between rows y - 1 and y
+            const int a = (y - 1) * size + x + 1, b = a + 1, c = a + size, d = c + 1;
+            const int vertices = (y + 1) * size;
+            for (int tri : {0, 1}) {
+                file << "f";
+                for (int v : tri == 0 ? std::vector<int>{a, b, d} : std::vector<int>{a, d, c}) {
+                    const int index = relative ? v - vertices - 1 : v;
+                    file << " " << index << "/" << v << "/" << v;
+                }
+                file << "\n";
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 2237; // 2237^2 is just over 5M vertices
+    const std::string filename = argc > 2 ? argv[2] : "obj_loader_bench.obj";
+    const std::string relativeFilename = filename + ".relative.obj";
+    const int threads =
+        argc > 3 ? std::stoi(argv[3]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    auto start = std::chrono::steady_clock::now();
+    writeGrid(filename, size, false);
+    writeGrid(relativeFilename, size, true);
+    std::ifstream sizeProbe(filename, std::ios::ate | std::ios::binary);
+    const double megabytes = sizeProbe.tellg() / 1e6;
+    std::cout << filename << ": " << size * size << " vertices, " << megabytes << " MB, written in "
+              << bench::elapsedMs(start) << " ms" << std::endl;
+
+    ShapeOp::Matrix3X points;
+    std::vector<std::vector<int>> faces;
+    start = std::chrono::steady_clock::now();
+    readOBJ(filename, points, faces);
+    const double baselineMs = bench::elapsedMs(start);
+    std::cout << "getline/istringstream: " << baselineMs << " ms, " << megabytes / baselineMs * 1e3 << " MB/s"
+              << std::endl;
+
+    bool ok = true;
+    for (int t : threads > 1 ? std::vector<int>{1, threads} : std::vector<int>{1}) {
+        start = std::chrono::steady_clock::now();
+        ShapeOp::Mesh mesh = ShapeOp::loadOBJ(filename, t);
+        const double ms = bench::elapsedMs(start);
+        std::cout << "loadOBJ, " << t << " thread(s): " << ms << " ms, " << megabytes / ms * 1e3 << " MB/s, "
+                  << baselineMs / ms << "x" << std::endl;
+        ok = ok && mesh.points == points && mesh.faceList() == faces;
+    }
+
+    ShapeOp::Mesh relative = ShapeOp::loadOBJ(relativeFilename);
+    ok = ok && relative.points == points && relative.faceList() == faces;
+    std::cout << (ok ? "meshes match" : "MISMATCH") << std::endl;
+
+    std::remove(filename.c_str());
+    std::remove(relativeFilename.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Corner pins as 1e5-weight ClosenessConstraints (what the example drivers do) against
+// ExtendedSolver::fixVertex, on the cable net of cable_net.cpp: initialize() time, the
+// spread of the factorization's diagonal as a conditioning proxy, iterations until no
+// point moves more than the tolerance, how far the pins drift, and re-convergence after
+// moving the lifted corners up, which neither approach refactorizes for.
+// Usage: pin_bench [grid size] [tolerance]
+
+namespace {
+
+struct Pin {
+    int id;
+    ShapeOp::Vector3 target;
+};
+
+// bench::cableNet with its pins returned rather than added
+std::vector<Pin> cableNetEdges(ShapeOp::ExtendedSolver &solver, int size) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    ShapeOp::Matrix3X points(3, size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            points.col(index(x, y)) = ShapeOp::Vector3(x * 2.0 / (size - 1), y * 2.0 / (size - 1), 0.0);
+        }
+    }
+    solver.setPoints(points);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            for (int next : {x + 1 < size ? index(x + 1, y) : -1, y + 1 < size ? index(x, y + 1) : -1}) {
+                if (next < 0) continue;
+                solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                    std::vector<int>{index(x, y), next}, 100.0, solver.getPoints(), 0.45, 0.55));
+            }
+        }
+    }
+    const ShapeOp::Vector3 lift(0.0, 0.0, 1.0);
+    return {{index(0, 0), points.col(index(0, 0)) + lift},
+            {index(size - 1, size - 1), points.col(index(size - 1, size - 1)) + lift},
+            {index(size - 1, 0), points.col(index(size - 1, 0))},
+            {index(0, size - 1), points.col(index(0, size - 1))}};
+}
+
+double drift(const ShapeOp::ExtendedSolver &solver, const std::vector<Pin> &pins) {
+    double worst = 0.0;
+    for (const Pin &pin : pins) {
+        worst = std::max<double>(worst, (solver.getPoints().col(pin.id) - pin.target).norm());
+    }
+    return worst;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 128;
+    const double tolerance = argc > 2 ? std::stod(argv[2]) : 1e-6;
+    const unsigned int budget = 100000;
+    std::cout << size << "x" << size << " cable net, displacement tolerance " << tolerance << std::endl;
+
+    ShapeOp::Matrix3X solved[2];
+    for (int hard = 0; hard < 2; ++hard) {
+        ShapeOp::ExtendedSolver solver;
+        std::vector<Pin> pins = cableNetEdges(solver, size);
+        std::vector<std::shared_ptr<ShapeOp::ClosenessConstraint>> penalties;
+        for (const Pin &pin : pins) {
+            if (hard) {
+                solver.fixVertex(pin.id, pin.target);
+            } else {
+                auto constraint = std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{pin.id}, 1e5,
+                                                                                 solver.getPoints());
+                constraint->setPosition(pin.target);
+                solver.addConstraint(constraint);
+                penalties.push_back(constraint);
+            }
+        }
+        solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Displacement, tolerance);
+
+        auto start = std::chrono::steady_clock::now();
+        solver.initialize();
+        const double initializeMs = bench::elapsedMs(start);
+        const auto factorization = solver.getFactorization();
+        const ShapeOp::GlobalVectorX &D = factorization->D;
+
+        start = std::chrono::steady_clock::now();
+        solver.solve(budget);
+        const double solveMs = bench::elapsedMs(start);
+        const unsigned int iterations = solver.getIterations();
+        const double pinDrift = drift(solver, pins);
+        solved[hard] = solver.getPoints();
+
+        // Lift the raised corners by another 0.1 and solve again, without refactorizing
+        for (int k = 0; k < 2; ++k) {
+            pins[k].target.z() += 0.1;
+            if (hard) {
+                solver.fixVertex(pins[k].id, pins[k].target);
+            } else {
+                penalties[k]->setPosition(pins[k].target);
+            }
+        }
+        start = std::chrono::steady_clock::now();
+        solver.solve(budget);
+        const double moveMs = bench::elapsedMs(start);
+
+        std::cout << (hard ? "fixVertex: " : "penalty:   ") << D.size() << " unknowns, initialize " << initializeMs
+                  << " ms, D max/min " << D.maxCoeff() / D.minCoeff() << std::endl;
+        std::cout << "  solve: " << iterations << " iterations, " << solveMs << " ms, pin drift " << pinDrift
+                  << std::endl;
+        std::cout << "  after moving pins: " << solver.getIterations() << " iterations, " << moveMs
+                  << " ms, pin drift " << drift(solver, pins) << std::endl;
+    }
+    std::cout << "max difference between the solutions: " << (solved[0] - solved[1]).cwiseAbs().maxCoeff()
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Throughput and accuracy of this build's precision (SHAPEOP_PRECISION) on the example
+// scenes. Times the local step and whole iterations, and saves the solved points; given
+// the directory a double build saved its points to, reports how far this build's points
+// are from them, absolute and relative to the scene's size.
+// Usage: precision_bench [iterations] [output dir] [reference dir]
+//   e.g. run the double build with output dir ref/, then float and mixed against ref/
+
+namespace {
+
+struct Case {
+    const char *name;
+    bool dynamic;
+    void (*build)(ShapeOp::ExtendedSolver &);
+};
+
+void savePoints(const std::string &filename, const ShapeOp::Matrix3X &points) {
+    const std::vector<double> values(points.data(), points.data() + points.size());
+    const std::uint64_t count = values.size();
+    std::ofstream file(filename, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char *>(values.data()), sizeof(double) * count);
+}
+
+bool loadPoints(const std::string &filename, std::vector<double> &values) {
+    std::ifstream file(filename, std::ios::binary);
+    std::uint64_t count = 0;
+    if (!file.read(reinterpret_cast<char *>(&count), sizeof(count))) return false;
+    values.resize(count);
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(values.data()), sizeof(double) * count));
+}
+
+const char *precision() {
+#ifdef SHAPEOP_MIXED_PRECISION
+    return "mixed (float points, double global system)";
+#else
+    return sizeof(ShapeOp::Scalar) == sizeof(float) ? "float" : "double";
+#endif
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+    const std::string output = argc > 2 ? std::string(argv[2]) + "/" : "";
+    const std::string reference = argc > 3 ? std::string(argv[3]) + "/" : "";
+    std::cout << "precision: " << precision() << ", " << iterations << " iterations" << std::endl;
+
+    const Case cases[] = {
+        {"wind_cloth", true,
+         [](ShapeOp::ExtendedSolver &solver) {
+             solver.setPoints(bench::clothGrid(128, 128));
+             bench::addClothConstraints(solver, 128, 128);
+             solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+         }},
+        {"cable_net", false, [](ShapeOp::ExtendedSolver &solver) { bench::cableNet(solver, 128); }},
+        {"unary_force", false, [](ShapeOp::ExtendedSolver &solver) { bench::unaryForceNet(solver, 128); }},
+        {"balloon_box", false, [](ShapeOp::ExtendedSolver &solver) { bench::balloonBox(solver, 32); }},
+    };
+
+    bool ok = true;
+    for (const Case &c : cases) {
+        ShapeOp::ExtendedSolver solver;
+        c.build(solver);
+        solver.initialize(c.dynamic);
+
+        auto start = std::chrono::steady_clock::now();
+        const int localSteps = 20;
+        for (int k = 0; k < localSteps; ++k) solver.projectConstraints();
+        const double localMs = bench::elapsedMs(start) / localSteps;
+
+        // Dynamic scenes advance one frame of 10 iterations per solve(), static ones
+        // iterate towards their equilibrium in one solve()
+        start = std::chrono::steady_clock::now();
+        if (c.dynamic) {
+            for (int frame = 0; frame < iterations / 10; ++frame) solver.solve(10);
+        } else {
+            solver.solve(iterations);
+        }
+        const double iterationUs = bench::elapsedMs(start) * 1e3 / iterations;
+
+        const ShapeOp::Matrix3X &points = solver.getPoints();
+        std::cout << c.name << ": " << points.cols() << " vertices, local step " << localMs * 1e3 << " us, "
+                  << iterationUs << " us/iteration";
+        if (!points.allFinite()) {
+            std::cout << ", NOT FINITE";
+            ok = false;
+        }
+        if (!reference.empty()) {
+            std::vector<double> expected;
+            if (!loadPoints(reference + c.name + ".points", expected) ||
+                expected.size() != static_cast<size_t>(points.size())) {
+                std::cerr << std::endl << "No matching reference points in " << reference << std::endl;
+                return 1;
+            }
+            const Eigen::Map<const Eigen::Matrix3Xd> ref(expected.data(), 3, points.cols());
+            const double deviation = (points.cast<double>() - ref).cwiseAbs().maxCoeff();
+            const double extent = (ref.rowwise().maxCoeff() - ref.rowwise().minCoeff()).norm();
+            std::cout << ", max deviation " << deviation << " (" << deviation / extent << " of the extent)";
+        }
+        std::cout << std::endl;
+        if (!output.empty()) savePoints(output + c.name + ".points", points);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ConstraintBuilder.h"
+#include "ExtendedSolver.h"
+#include "MeshIO.h"
+#include "Reordering.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Vertex and constraint ordering on a triangulated grid whose vertices (and so faces)
+// are randomly renumbered, as a stand-in for a large OBJ export: individual edge
+// constraints plus a weak closeness constraint per vertex, created in shuffled order.
+// Compares the shuffled order as is, with ExtendedSolver::sortConstraints() alone, and
+// after renumbering the mesh by reverse Cuthill-McKee or a Morton curve (constraints
+// rebuilt from the renumbered mesh, then sorted). Reports the edge bandwidth, assembly
+// time (initialize() with the matrix-free CG global step, so no factorization), local
+// step time, and a few full CG iterations, with the hardware cache references and misses
+// of the local step as perf stat counts them, where the kernel allows perf_event_open.
+// Usage: reorder_bench [grid size, 1000 = 1M vertices] [local step repetitions] [iterations]
+
+namespace {
+
+// Hardware counters of this thread, user space only, read as perf stat would
+class CacheCounters {
+public:
+    CacheCounters() {
+        references_ = open(PERF_COUNT_HW_CACHE_REFERENCES);
+        misses_ = open(PERF_COUNT_HW_CACHE_MISSES);
+    }
+    ~CacheCounters() {
+        for (int fd : {references_, misses_}) {
+            if (fd >= 0) close(fd);
+        }
+    }
+    bool available() const { return references_ >= 0 && misses_ >= 0; }
+
+    void start() {
+        for (int fd : {references_, misses_}) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+    // References and misses since start()
+    std::pair<std::uint64_t, std::uint64_t> stop() {
+        return {read(references_), read(misses_)};
+    }
+
+private:
+    static int open(std::uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    static std::uint64_t read(int fd) {
+        std::uint64_t count = 0;
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (::read(fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+        }
+        return count;
+    }
+
+    int references_ = -1;
+    int misses_ = -1;
+};
+
+ShapeOp::Mesh triangulatedGrid(int size) {
+    ShapeOp::Mesh mesh;
+    mesh.points = bench::clothGrid(size, size, 1.0 / (size - 1));
+    for (const auto &face : bench::gridTriangles(size, size)) {
+        mesh.faceIndices.insert(mesh.faceIndices.end(), face.begin(), face.end());
+        mesh.faceOffsets.push_back(static_cast<int>(mesh.faceIndices.size()));
+    }
+    return mesh;
+}
+
+int bandwidth(const Eigen::Matrix2Xi &edges) {
+    int width = 0;
+    for (int e = 0; e < edges.cols(); ++e) {
+        width = std::max(width, std::abs(edges(0, e) - edges(1, e)));
+    }
+    return width;
+}
+
+void run(const std::string &name, const ShapeOp::Mesh &mesh, bool shuffleConstraints, bool sort, int repetitions,
+         int iterations, CacheCounters &counters) {
+    const Eigen::Matrix2Xi edges = ShapeOp::ConstraintBuilder::uniqueEdges(mesh.faceList());
+    const int n = static_cast<int>(mesh.points.cols());
+
+    ShapeOp::ExtendedSolver solver;
+    solver.setPoints(mesh.points);
+    solver.setGlobalSolver(ShapeOp::ExtendedSolver::GlobalSolver::ConjugateGradient);
+    std::vector<std::shared_ptr<ShapeOp::Constraint>> constraints;
+    ShapeOp::ConstraintBuilder builder(solver.getPoints());
+    builder.edgeStrain(edges, 10.0, 0.8, 1.2, constraints);
+    Eigen::VectorXi ids(n);
+    std::iota(ids.data(), ids.data() + n, 0);
+    builder.closeness(ids, 1e-3, constraints);
+    if (shuffleConstraints) {
+        std::shuffle(constraints.begin(), constraints.end(), std::mt19937(7));
+    }
+    ShapeOp::addConstraints(solver, constraints);
+    constraints.clear();
+    if (sort) {
+        solver.sortConstraints();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    solver.initialize();
+    const double assemblyMs = bench::elapsedMs(start);
+
+    solver.projectConstraints();
+    counters.start();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) solver.projectConstraints();
+    const double localMs = bench::elapsedMs(start) / repetitions;
+    const auto cache = counters.stop();
+
+    start = std::chrono::steady_clock::now();
+    solver.solve(iterations);
+    const double iterationMs = bench::elapsedMs(start) / iterations;
+
+    std::cout << name << ": bandwidth " << bandwidth(edges) << ", assembly " << assemblyMs << " ms, local step "
+              << localMs << " ms";
+    if (counters.available()) {
+        std::cout << " (" << cache.first / repetitions << " cache references, " << cache.second / repetitions
+                  << " misses per step)";
+    }
+    std::cout << ", iteration " << iterationMs << " ms" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 1000;
+    const int repetitions = argc > 2 ? std::stoi(argv[2]) : 10;
+    const int iterations = argc > 3 ? std::stoi(argv[3]) : 5;
+    CacheCounters counters;
+    std::cout << size << "x" << size << " triangulated grid, vertices shuffled; cache counters "
+              << (counters.available() ? "from perf_event_open" : "unavailable") << std::endl;
+
+    const ShapeOp::Mesh grid = triangulatedGrid(size);
+    std::vector<int> shuffle(grid.points.cols());
+    std::iota(shuffle.begin(), shuffle.end(), 0);
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937(42));
+    const ShapeOp::Mesh shuffled = ShapeOp::reorderMesh(grid, shuffle);
+
+    run("shuffled", shuffled, true, false, repetitions, iterations, counters);
+    run("shuffled, constraints sorted", shuffled, true, true, repetitions, iterations, counters);
+
+    auto start = std::chrono::steady_clock::now();
+    const auto rcm = ShapeOp::reverseCuthillMcKee(
+        static_cast<int>(shuffled.points.cols()), ShapeOp::ConstraintBuilder::uniqueEdges(shuffled.faceList()));
+    const ShapeOp::Mesh rcmMesh = ShapeOp::reorderMesh(shuffled, rcm);
+    std::cout << "reverse Cuthill-McKee ordering " << bench::elapsedMs(start) << " ms" << std::endl;
+    run("reverse Cuthill-McKee", rcmMesh, false, true, repetitions, iterations, counters);
+
+    start = std::chrono::steady_clock::now();
+    const ShapeOp::Mesh mortonMesh = ShapeOp::reorderMesh(shuffled, ShapeOp::mortonOrder(shuffled.points));
+    std::cout << "Morton ordering " << bench::elapsedMs(start) << " ms" << std::endl;
+    run("Morton", mortonMesh, false, true, repetitions, iterations, counters);
+    return 0;
+}
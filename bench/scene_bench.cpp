@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include "Scene.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Start-up latency of a cable net with about 1M edge constraints (cable_net.cpp scaled up):
+// built constraint by constraint as cable_net.cpp does, loaded from a scene file, and
+// loaded from a scene file with the factorization embedded. Checks that a saved and
+// loaded scene is identical and solves to the same points as the programmatic build.
+// The files are read right after being written, so they come from the page cache. Then
+// round-trips hard pins with the multigrid and conjugate gradient settings on a small net.
+// Usage: scene_bench [grid size] [file]
+
+static ShapeOp::Scene cableNetScene(int size, double shrinkFactor = 0.5) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    ShapeOp::Scene scene;
+    scene.points.resize(3, size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            scene.points.col(index(x, y)) = ShapeOp::Vector3(x * 2.0 / (size - 1), y * 2.0 / (size - 1), 0.0);
+        }
+    }
+
+    // Same pins, in the same order, as bench::cableNet
+    scene.closenessIds = Eigen::VectorXi(4);
+    scene.closenessIds << index(0, 0), index(size - 1, size - 1), index(size - 1, 0), index(0, size - 1);
+    scene.closenessWeights = ShapeOp::VectorX::Constant(4, 1e5);
+    scene.closenessTargets.resize(3, 4);
+    for (int k = 0; k < 4; ++k) {
+        scene.closenessTargets.col(k) = scene.points.col(scene.closenessIds[k]);
+        if (k < 2) scene.closenessTargets(2, k) += 1.0;
+    }
+
+    scene.edges.resize(2, 2 * size * (size - 1));
+    int e = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            if (x + 1 < size) scene.edges.col(e++) << index(x, y), index(x + 1, y);
+            if (y + 1 < size) scene.edges.col(e++) << index(x, y), index(x, y + 1);
+        }
+    }
+    scene.edgeWeights = ShapeOp::VectorX::Constant(e, 100.0);
+    scene.edgeRangeMin = ShapeOp::VectorX::Constant(e, shrinkFactor - 0.05);
+    scene.edgeRangeMax = ShapeOp::VectorX::Constant(e, shrinkFactor + 0.05);
+    return scene;
+}
+
+static bool sameScene(const ShapeOp::Scene &a, const ShapeOp::Scene &b) {
+    return a.points == b.points && a.closenessIds == b.closenessIds && a.closenessWeights == b.closenessWeights &&
+           a.closenessTargets == b.closenessTargets && a.edges == b.edges && a.edgeWeights == b.edgeWeights &&
+           a.edgeRangeMin == b.edgeRangeMin && a.edgeRangeMax == b.edgeRangeMax && a.packEdges == b.packEdges &&
+           a.gravity == b.gravity && a.vertexForceIds == b.vertexForceIds && a.vertexForces == b.vertexForces &&
+           a.normalFaceOffsets == b.normalFaceOffsets && a.normalFaceIndices == b.normalFaceIndices &&
+           a.normalForceMagnitude == b.normalForceMagnitude && a.dynamic == b.dynamic && a.masses == b.masses &&
+           a.damping == b.damping && a.timestep == b.timestep && a.iterations == b.iterations &&
+           a.criterion == b.criterion && a.tolerance == b.tolerance && a.andersonWindow == b.andersonWindow &&
+           a.chebyshev == b.chebyshev && a.fixedIds == b.fixedIds && a.fixedPositions == b.fixedPositions &&
+           a.globalSolver == b.globalSolver && a.preconditioner == b.preconditioner &&
+           a.cgTolerance == b.cgTolerance && a.cgMaxIterations == b.cgMaxIterations &&
+           a.hierarchyLevels == b.hierarchyLevels && a.gridRows == b.gridRows && a.gridCols == b.gridCols &&
+           a.preSmoothing == b.preSmoothing && a.postSmoothing == b.postSmoothing &&
+           a.coarsestIterations == b.coarsestIterations;
+}
+
+// Saves and loads a small cable net with hard pins and the given global solver and
+// hierarchy settings, and checks that the loaded scene sets up the same solver: same
+// pins and levels, and the same points after a few iterations
+static bool settingsRoundTrip(const std::string &name, ShapeOp::Scene scene, const std::string &filename) {
+    const int size = 17;
+    scene.fixedIds = Eigen::VectorXi(2);
+    scene.fixedIds << 0, size * size - 1;
+    scene.fixedPositions = scene.points(Eigen::all, scene.fixedIds);
+    scene.fixedPositions(2, 1) += 0.5;
+    saveScene(filename, scene);
+    const ShapeOp::Scene loaded = ShapeOp::loadScene(filename);
+    std::remove(filename.c_str());
+
+    ShapeOp::ExtendedSolver original, reloaded;
+    bool ok = sameScene(scene, loaded) && scene.setUp(original) && loaded.setUp(reloaded);
+    ok = ok && reloaded.isFixed(0) && reloaded.isFixed(size * size - 1) &&
+         reloaded.getLevels() == original.getLevels();
+    original.solve(5);
+    reloaded.solve(5);
+    ok = ok && original.getPoints() == reloaded.getPoints() &&
+         reloaded.getPoints().col(size * size - 1) == scene.fixedPositions.col(1);
+    std::cout << name << ": " << (ok ? "pins and settings round trip" : "MISMATCH") << " (" << reloaded.getLevels()
+              << " levels)" << std::endl;
+    return ok;
+}
+
+static double megabytes(const std::string &filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    return file.tellg() / 1e6;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 708; // 2 * 708 * 707 is just over 1M edges
+    const std::string filename = argc > 2 ? argv[2] : "scene_bench.scene";
+    const std::string factorizedFilename = filename + ".factorized";
+    const int iterations = 5;
+
+    ShapeOp::Scene scene = cableNetScene(size);
+    std::cout << size << "x" << size << " cable net, " << scene.closenessIds.size() + scene.edges.cols()
+              << " constraints" << std::endl;
+
+    // Programmatic construction, one make_shared per constraint
+    auto start = std::chrono::steady_clock::now();
+    ShapeOp::ExtendedSolver built;
+    bench::cableNet(built, size);
+    const double buildMs = bench::elapsedMs(start);
+    built.initialize();
+    const double builtMs = bench::elapsedMs(start);
+    std::cout << "programmatic: " << builtMs << " ms (" << buildMs << " ms constraints, " << builtMs - buildMs
+              << " ms initialize)" << std::endl;
+    built.solve(iterations);
+
+    // Scene files, without and with the factorization
+    {
+        ShapeOp::ExtendedSolver solver;
+        scene.setUp(solver);
+        saveScene(filename, scene);
+        scene.factorization = solver.getFactorization();
+        saveScene(factorizedFilename, scene);
+    }
+
+    bool ok = true;
+    for (const std::string &file : {filename, factorizedFilename}) {
+        start = std::chrono::steady_clock::now();
+        ShapeOp::Scene loaded = ShapeOp::loadScene(file);
+        const double loadMs = bench::elapsedMs(start);
+        ShapeOp::ExtendedSolver solver;
+        ok = ok && loaded.setUp(solver);
+        const double totalMs = bench::elapsedMs(start);
+        std::cout << (loaded.factorization ? "scene + factorization: " : "scene: ") << totalMs << " ms ("
+                  << loadMs << " ms load, " << totalMs - loadMs << " ms set up), " << megabytes(file) << " MB, "
+                  << builtMs / totalMs << "x" << std::endl;
+
+        ok = ok && sameScene(scene, loaded);
+        solver.solve(iterations);
+        const double difference = (solver.getPoints() - built.getPoints()).cwiseAbs().maxCoeff();
+        std::cout << "  max difference after " << iterations << " iterations: " << difference << std::endl;
+        ok = ok && difference < 1e-9;
+    }
+    std::cout << (ok ? "round trip exact" : "MISMATCH") << std::endl;
+
+    ShapeOp::Scene multigrid = cableNetScene(17);
+    multigrid.hierarchyLevels = 3;
+    multigrid.gridRows = multigrid.gridCols = 17;
+    multigrid.preSmoothing = 2;
+    multigrid.postSmoothing = 2;
+    multigrid.coarsestIterations = 10;
+    ok = settingsRoundTrip("pins + multigrid", multigrid, filename) && ok;
+    ShapeOp::Scene cg = cableNetScene(17);
+    cg.globalSolver = ShapeOp::ExtendedSolver::GlobalSolver::ConjugateGradient;
+    cg.preconditioner = ShapeOp::ExtendedSolver::Preconditioner::IncompleteCholesky;
+    cg.cgTolerance = 1e-8;
+    cg.cgMaxIterations = 500;
+    ok = settingsRoundTrip("pins + conjugate gradient", cg, filename) && ok;
+
+    std::remove(filename.c_str());
+    std::remove(factorizedFilename.c_str());
+    return ok ? 0 : 1;
+}
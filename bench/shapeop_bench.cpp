@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include "MeshIO.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark suite for the solver hot paths. Every scene is generated procedurally and
+// run at each grid size; each phase is timed on its own, repeated until it has run for
+// the minimum time, and reported on stdout and as JSON for regression tracking.
+//
+// Usage: shapeop_bench [--sizes=32,64,128] [--scenes=cloth,cable_net,unary_force,balloon_box]
+//                      [--phases=setup,initialize,local_step,global_step,forces,iteration,
+//                                write_obj,write_ply,load_obj]
+//                      [--min-time=ms] [--json=file, - for stdout] [--tmp=path prefix]
+
+namespace {
+
+struct Scene {
+    std::string name;
+    bool dynamic;
+    std::function<void(ShapeOp::ExtendedSolver &, int)> build;
+    std::function<ShapeOp::Mesh(int)> mesh;
+};
+
+// The example programs' scenes. Grid scenes take size as the number of vertices per
+// side; balloon_box takes size / 2 quads per cube side, about 1.5 size^2 vertices.
+std::vector<Scene> scenes() {
+    auto grid = [](int size) { return ShapeOp::gridMesh(bench::clothGrid(size, size), size, size); };
+    return {
+        {"cloth", true,
+         [](ShapeOp::ExtendedSolver &solver, int size) {
+             solver.setPoints(bench::clothGrid(size, size));
+             bench::addClothConstraints(solver, size, size);
+             solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+         },
+         grid},
+        {"cable_net", false, [](ShapeOp::ExtendedSolver &solver, int size) { bench::cableNet(solver, size); }, grid},
+        {"unary_force", false,
+         [](ShapeOp::ExtendedSolver &solver, int size) { bench::unaryForceNet(solver, size); }, grid},
+        {"balloon_box", false,
+         [](ShapeOp::ExtendedSolver &solver, int size) { bench::balloonBox(solver, std::max(1, size / 2)); },
+         [](int size) {
+             ShapeOp::Mesh mesh;
+             std::vector<std::vector<int>> faces;
+             bench::boxSurface(std::max(1, size / 2), mesh.points, faces);
+             for (const auto &face : faces) {
+                 mesh.faceIndices.insert(mesh.faceIndices.end(), face.begin(), face.end());
+                 mesh.faceOffsets.push_back(static_cast<int>(mesh.faceIndices.size()));
+             }
+             return mesh;
+         }},
+    };
+}
+
+struct Result {
+    std::string scene;
+    int size;
+    std::string phase;
+    long vertices;
+    long repetitions;
+    double meanNs;
+    double minNs;
+    double medianNs;
+};
+
+// Runs prepare() untimed and run() timed until run() has taken minTimeMs in total and
+// at least three repetitions
+template <typename Prepare, typename Run>
+Result measure(double minTimeMs, Prepare &&prepare, Run &&run) {
+    std::vector<double> times;
+    double total = 0.0;
+    while (times.size() < 3 || (total < minTimeMs * 1e6 && times.size() < 100000)) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        const double ns =
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(ns);
+        total += ns;
+    }
+    std::sort(times.begin(), times.end());
+    Result result;
+    result.repetitions = static_cast<long>(times.size());
+    result.meanNs = total / times.size();
+    result.minNs = times.front();
+    result.medianNs = times[times.size() / 2];
+    return result;
+}
+
+std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    for (std::string item; std::getline(stream, item, ',');) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool selected(const std::vector<std::string> &list, const std::string &name) {
+    return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+void writeJson(std::ostream &out, const std::vector<Result> &results) {
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+#ifdef SHAPEOP_OPENMP
+    const bool openmp = true;
+#else
+    const bool openmp = false;
+#endif
+
+    out << "{\n  \"context\": {\"date\": \"" << date << "\", \"hardware_threads\": "
+        << std::thread::hardware_concurrency() << ", \"openmp\": " << (openmp ? "true" : "false")
+        << ", \"scalar_bytes\": " << sizeof(ShapeOp::Scalar) << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        out << "    {\"name\": \"" << r.scene << "/" << r.size << "/" << r.phase << "\", \"scene\": \"" << r.scene
+            << "\", \"size\": " << r.size << ", \"phase\": \"" << r.phase << "\", \"vertices\": " << r.vertices
+            << ", \"repetitions\": " << r.repetitions << ", \"mean_ns\": " << r.meanNs << ", \"min_ns\": " << r.minNs
+            << ", \"median_ns\": " << r.medianNs << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {32, 64, 128};
+    std::vector<std::string> sceneFilter, phaseFilter;
+    double minTimeMs = 200.0;
+    std::string json = "shapeop_bench.json";
+    std::string tmp = "shapeop_bench_io";
+
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--sizes") {
+            sizes.clear();
+            for (const auto &s : split(value)) sizes.push_back(std::stoi(s));
+        } else if (key == "--scenes") {
+            sceneFilter = split(value);
+        } else if (key == "--phases") {
+            phaseFilter = split(value);
+        } else if (key == "--min-time") {
+            minTimeMs = std::stod(value);
+        } else if (key == "--json") {
+            json = value;
+        } else if (key == "--tmp") {
+            tmp = value;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    auto report = [&](const Scene &scene, int size, const std::string &phase, long vertices, Result result) {
+        result.scene = scene.name;
+        result.size = size;
+        result.phase = phase;
+        result.vertices = vertices;
+        std::cout << scene.name << "/" << size << "/" << phase << ": " << result.medianNs / 1e3 << " us median, "
+                  << result.minNs / 1e3 << " us min, " << result.repetitions << " reps" << std::endl;
+        results.push_back(result);
+    };
+    const auto noPrepare = [] {};
+
+    for (const Scene &scene : scenes()) {
+        if (!selected(sceneFilter, scene.name)) continue;
+        for (int size : sizes) {
+            std::unique_ptr<ShapeOp::ExtendedSolver> solver;
+            auto fresh = [&] {
+                solver.reset();
+                solver = std::make_unique<ShapeOp::ExtendedSolver>();
+            };
+            auto built = [&] {
+                fresh();
+                scene.build(*solver, size);
+            };
+            auto initialized = [&] {
+                built();
+                solver->initialize(scene.dynamic);
+            };
+            initialized();
+            const long vertices = static_cast<long>(solver->getPoints().cols());
+
+            if (selected(phaseFilter, "setup")) {
+                report(scene, size, "setup", vertices,
+                       measure(minTimeMs, fresh, [&] { scene.build(*solver, size); }));
+            }
+            if (selected(phaseFilter, "initialize")) {
+                report(scene, size, "initialize", vertices,
+                       measure(minTimeMs, built, [&] { solver->initialize(scene.dynamic); }));
+            }
+
+            // The per-iteration phases run on one solver, moving through the solve as they go
+            initialized();
+            if (selected(phaseFilter, "local_step")) {
+                report(scene, size, "local_step", vertices,
+                       measure(minTimeMs, noPrepare, [&] { solver->projectConstraints(); }));
+            }
+            if (selected(phaseFilter, "global_step")) {
+                report(scene, size, "global_step", vertices,
+                       measure(minTimeMs, noPrepare, [&] { solver->globalStep(); }));
+            }
+            if (selected(phaseFilter, "forces")) {
+                report(scene, size, "forces", vertices,
+                       measure(minTimeMs, noPrepare, [&] { solver->computeForces(); }));
+            }
+            if (selected(phaseFilter, "iteration")) {
+                report(scene, size, "iteration", vertices,
+                       measure(minTimeMs, noPrepare, [&] { solver->solve(1); }));
+            }
+
+            ShapeOp::Mesh mesh = scene.mesh(size);
+            mesh.points = solver->getPoints();
+            const std::string obj = tmp + ".obj", ply = tmp + ".ply";
+            if (selected(phaseFilter, "write_obj")) {
+                report(scene, size, "write_obj", vertices,
+                       measure(minTimeMs, noPrepare, [&] { ShapeOp::writeOBJ(obj, mesh); }));
+            }
+            if (selected(phaseFilter, "write_ply")) {
+                report(scene, size, "write_ply", vertices,
+                       measure(minTimeMs, noPrepare, [&] { ShapeOp::writePLY(ply, mesh); }));
+            }
+            if (selected(phaseFilter, "load_obj")) {
+                ShapeOp::writeOBJ(obj, mesh);
+                report(scene, size, "load_obj", vertices,
+                       measure(minTimeMs, noPrepare, [&] { ShapeOp::loadOBJ(obj); }));
+            }
+            std::remove(obj.c_str());
+            std::remove(ply.c_str());
+        }
+    }
+
+    if (json == "-") {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream out(json);
+        if (!out) {
+            std::cerr << "Failed to open " << json << std::endl;
+            return 1;
+        }
+        writeJson(out, results);
+        std::cout << "Wrote " << results.size() << " results to " << json << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include "TopologyCache.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Time to initialize many parameter variants of one cable net (a different
+// shrinkFactor each, as in cable_net.cpp), with every solver analyzing its own
+// pattern versus all of them sharing a TopologyCache, on one thread and on all cores.
+// Usage: topology_cache_bench [grid size] [variants] [threads]
+
+static void setUp(ShapeOp::ExtendedSolver &solver, int size, double shrinkFactor) {
+    auto index = [size](int x, int y) { return y * size + x; };
+    solver.setPoints(bench::clothGrid(size, size, 2.0 / (size - 1)));
+
+    for (int id : {index(0, 0), index(size - 1, 0), index(0, size - 1), index(size - 1, size - 1)}) {
+        solver.addConstraint(std::make_shared<ShapeOp::ClosenessConstraint>(std::vector<int>{id}, 1e5,
+                                                                            solver.getPoints()));
+    }
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            for (int next : {x + 1 < size ? index(x + 1, y) : -1, y + 1 < size ? index(x, y + 1) : -1}) {
+                if (next < 0) continue;
+                solver.addConstraint(std::make_shared<ShapeOp::EdgeStrainConstraint>(
+                    std::vector<int>{index(x, y), next}, 100.0, solver.getPoints(), shrinkFactor - 0.05,
+                    shrinkFactor + 0.05));
+            }
+        }
+    }
+}
+
+static double shrinkFactor(int variant, int variants) {
+    return 0.3 + 0.4 * variant / std::max(variants - 1, 1);
+}
+
+// Total initialize() time over all variants, spread over the given number of threads
+static double run(int size, int variants, int threads, const std::shared_ptr<ShapeOp::TopologyCache> &cache) {
+    std::atomic<int> next(0);
+    std::atomic<long long> totalNs(0);
+    auto worker = [&]() {
+        for (int v = next++; v < variants; v = next++) {
+            ShapeOp::ExtendedSolver solver;
+            setUp(solver, size, shrinkFactor(v, variants));
+            solver.setTopologyCache(cache);
+            auto start = std::chrono::steady_clock::now();
+            solver.initialize();
+            totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                           .count();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+    for (auto &t : pool) t.join();
+    double wallMs = bench::elapsedMs(start);
+
+    std::cout << "  " << threads << " thread(s): " << totalNs / 1e6 << " ms in initialize(), " << wallMs
+              << " ms wall including setup" << std::endl;
+    return totalNs / 1e6;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 50;
+    const int variants = argc > 2 ? std::stoi(argv[2]) : 1000;
+    const int threads =
+        argc > 3 ? std::stoi(argv[3]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::cout << size << "x" << size << " cable net, " << variants << " variants" << std::endl;
+
+    std::cout << "own analysis per solver:" << std::endl;
+    double own = run(size, variants, 1, nullptr);
+    if (threads > 1) run(size, variants, threads, nullptr);
+
+    std::cout << "shared topology cache:" << std::endl;
+    auto cache = std::make_shared<ShapeOp::TopologyCache>();
+    double shared = run(size, variants, 1, cache);
+    if (threads > 1) {
+        cache->clear();
+        run(size, variants, threads, cache);
+    }
+    std::cout << "  " << cache->size() << " pattern(s), " << cache->hits() << " hits, " << cache->misses()
+              << " misses" << std::endl;
+    std::cout << "speedup: " << own / shared << "x" << std::endl;
+
+    // The cached analysis must give the same result as a solver's own
+    ShapeOp::ExtendedSolver reference, cached;
+    setUp(reference, size, 0.5);
+    setUp(cached, size, 0.5);
+    cached.setTopologyCache(cache);
+    reference.initialize();
+    cached.initialize();
+    reference.solve(10);
+    cached.solve(10);
+    std::cout << "max difference: " << (reference.getPoints() - cached.getPoints()).cwiseAbs().maxCoeff()
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include "Trajectory.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Recording a hanging cloth (wind_cloth.cpp in dynamic mode, one iteration per frame)
+// through ExtendedSolver::setRecorder: solve time without and with recording, file size
+// with float32 and with quantized deltas, and the reader's sequential and random frame
+// access with the largest error against the points the solver produced.
+// Usage: trajectory_bench [grid size] [frames] [file]
+
+static double simulate(int size, int frames, const std::shared_ptr<ShapeOp::TrajectoryRecorder> &recorder,
+                       std::vector<ShapeOp::Matrix3X> *reference) {
+    ShapeOp::ExtendedSolver solver;
+    solver.setPoints(bench::clothGrid(size, size));
+    bench::addClothConstraints(solver, size, size);
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    solver.initialize(true);
+    solver.setRecorder(recorder);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        solver.solve(1);
+        if (reference) reference->push_back(solver.getPoints());
+    }
+    const double ms = bench::elapsedMs(start);
+    if (recorder) recorder->close();
+    return ms / frames;
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 100;
+    const int frames = argc > 2 ? std::stoi(argv[2]) : 500;
+    const std::string filename = argc > 3 ? argv[3] : "trajectory_bench.traj";
+    const ShapeOp::Mesh topology = ShapeOp::gridMesh(bench::clothGrid(size, size), size, size);
+
+    std::vector<ShapeOp::Matrix3X> reference;
+    simulate(size, frames, nullptr, &reference);
+    const double plainMs = simulate(size, frames, nullptr, nullptr);
+    std::cout << size << "x" << size << " hanging cloth, " << frames << " frames" << std::endl;
+    std::cout << "no recording: " << plainMs << " ms/frame" << std::endl;
+
+    bool ok = true;
+    for (double quantization : {0.0, 1e-3}) {
+        auto recorder = std::make_shared<ShapeOp::TrajectoryRecorder>(filename, topology, quantization);
+        const double ms = simulate(size, frames, recorder, nullptr);
+        std::ifstream sizeProbe(filename, std::ios::ate | std::ios::binary);
+        const double kb = sizeProbe.tellg() / 1e3;
+        std::cout << (quantization > 0.0 ? "quantized 1e-3: " : "float32 deltas: ") << ms << " ms/frame ("
+                  << (ms / plainMs - 1.0) * 100.0 << "% over no recording), " << kb / frames << " kB/frame vs "
+                  << 24.0 * size * size / 1e3 << " kB of doubles" << std::endl;
+
+        ShapeOp::TrajectoryReader reader(filename);
+        ok = ok && reader.frames() == frames;
+        double maxError = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < reader.frames(); ++f) {
+            maxError = std::max<double>(maxError, (reader.frame(f) - reference[f]).cwiseAbs().maxCoeff());
+        }
+        const double sequentialMs = bench::elapsedMs(start) / frames;
+
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> pick(0, reader.frames() - 1);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            const int f = pick(random);
+            maxError = std::max<double>(maxError, (reader.frame(f) - reference[f]).cwiseAbs().maxCoeff());
+        }
+        const double randomMs = bench::elapsedMs(start) / frames;
+        std::cout << "  read: " << sequentialMs << " ms/frame in order, " << randomMs
+                  << " ms/frame at random, max error " << maxError << std::endl;
+        // float32 rounding of coordinates of order 100, or half a quantization step
+        ok = ok && maxError <= std::max(1e-4, 0.5001 * quantization + 1e-4);
+    }
+    std::cout << (ok ? "frames match" : "MISMATCH") << std::endl;
+
+    std::remove(filename.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Latency of changing constraint weights after initialize() on a wind_cloth grid:
+//   low-rank - updateConstraints() with a Woodbury correction
+//   numeric  - updateConstraints() forced to refactorize (setMaxUpdateRank(0))
+//   full     - initialize() from scratch
+// Low-rank corrections accumulate until setMaxUpdateRank() and are then folded into a
+// numeric refactorization, so its timing is amortized over both. Each path is checked
+// against a freshly initialized solver after a few iterations.
+// Usage: update_bench [grid size] [repeats]
+
+static void setUp(ShapeOp::ExtendedSolver &solver, int size) {
+    solver.setPoints(bench::clothGrid(size, size));
+    bench::addClothConstraints(solver, size, size);
+    solver.addForces(std::make_shared<ShapeOp::GravityForce>(ShapeOp::Vector3(0.0, -0.1, 0.0)));
+    solver.initialize();
+}
+
+// Pin weights (constraints 0 and 1) for a given step of the sweep
+static void setPinWeights(ShapeOp::ExtendedSolver &solver, int step) {
+    solver.getConstraint(0)->setWeight(1e5 / (step + 2));
+    solver.getConstraint(1)->setWeight(1e5 * (step + 2));
+}
+
+// Moving a pin target is read by project() and needs no update at all
+static void movePin(ShapeOp::ExtendedSolver &solver) {
+    auto pin = std::dynamic_pointer_cast<ShapeOp::ClosenessConstraint>(solver.getConstraint(0));
+    pin->setPosition(ShapeOp::Vector3(0.0, 1.0, 0.0));
+}
+
+static double difference(ShapeOp::ExtendedSolver &solver, int size, int step) {
+    ShapeOp::ExtendedSolver reference;
+    setUp(reference, size);
+    setPinWeights(reference, step);
+    reference.initialize();
+    movePin(reference);
+    movePin(solver);
+
+    solver.setPoints(bench::clothGrid(size, size));
+    solver.solve(10);
+    reference.solve(10);
+    return (solver.getPoints() - reference.getPoints()).cwiseAbs().maxCoeff();
+}
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 100;
+    const int repeats = argc > 2 ? std::stoi(argv[2]) : 20;
+    const std::vector<int> pins = {0, 1};
+
+    std::cout << size << "x" << size << " grid, " << size * size << " vertices, " << repeats << " weight changes"
+              << std::endl;
+
+    ShapeOp::ExtendedSolver lowRank;
+    setUp(lowRank, size);
+    double lowRankMs = 0.0;
+    for (int step = 0; step < repeats; ++step) {
+        setPinWeights(lowRank, step);
+        auto start = std::chrono::steady_clock::now();
+        lowRank.updateConstraints(pins);
+        lowRankMs += bench::elapsedMs(start);
+    }
+
+    ShapeOp::ExtendedSolver numeric;
+    setUp(numeric, size);
+    numeric.setMaxUpdateRank(0);
+    double numericMs = 0.0;
+    for (int step = 0; step < repeats; ++step) {
+        setPinWeights(numeric, step);
+        auto start = std::chrono::steady_clock::now();
+        numeric.updateConstraints(pins);
+        numericMs += bench::elapsedMs(start);
+    }
+
+    ShapeOp::ExtendedSolver full;
+    setUp(full, size);
+    double fullMs = 0.0;
+    for (int step = 0; step < repeats; ++step) {
+        setPinWeights(full, step);
+        auto start = std::chrono::steady_clock::now();
+        full.initialize();
+        fullMs += bench::elapsedMs(start);
+    }
+
+    // A single pending correction, so the check exercises the Woodbury path
+    ShapeOp::ExtendedSolver single;
+    setUp(single, size);
+    setPinWeights(single, 0);
+    single.updateConstraints(pins);
+
+    std::cout << "low-rank update: " << lowRankMs / repeats << " ms, max difference "
+              << difference(single, size, 0) << std::endl;
+    std::cout << "numeric refactorization: " << numericMs / repeats << " ms, max difference "
+              << difference(numeric, size, repeats - 1) << std::endl;
+    std::cout << "full initialize: " << fullMs / repeats << " ms" << std::endl;
+    std::cout << "speedup: " << fullMs / lowRankMs << "x (low-rank), " << fullMs / numericMs << "x (numeric)"
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "BenchScenes.h"
+#include "ExtendedSolver.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Parameter sweep over the lift height of cable_net.cpp's raised corners: every step
+// builds a fresh solver from the flat grid and solves to the displacement tolerance,
+// cold (from the flat grid, factorizing) and warm (ExtendedSolver::setWarmStart with the
+// previous step's solution and factorization), and warm from a prediction extrapolated
+// linearly from the previous two solutions. Reports iterations and time per step,
+// initialize() included, the totals, and how far the warm solutions end up from the
+// cold ones. A last step lowers the pin weights, so the handed-over factorization is of
+// another matrix; exits with 1 if that warm solve doesn't end where the cold one does.
+// Usage: warm_start_bench [grid size] [steps] [tolerance]
+
+namespace {
+
+struct Run {
+    unsigned int iterations = 0;
+    double ms = 0.0;
+    ShapeOp::ExtendedSolver::WarmStart state;
+};
+
+Run solve(int size, double lift, double tolerance, const ShapeOp::ExtendedSolver::WarmStart *warm,
+          double pinWeight = 1e5) {
+    ShapeOp::ExtendedSolver solver;
+    bench::cableNet(solver, size, 0.5, lift);
+    for (int k = 0; k < 4; ++k) {
+        solver.getConstraint(k)->setWeight(pinWeight); // The corner pins
+    }
+    solver.setTolerance(ShapeOp::ExtendedSolver::StopCriterion::Displacement, tolerance);
+    if (warm) {
+        solver.setWarmStart(*warm);
+    }
+    Run run;
+    const auto start = std::chrono::steady_clock::now();
+    solver.initialize();
+    solver.solve(100000);
+    run.ms = bench::elapsedMs(start);
+    run.iterations = solver.getIterations();
+    run.state = solver.getWarmStart();
+    return run;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const int size = argc > 1 ? std::stoi(argv[1]) : 64;
+    const int steps = argc > 2 ? std::stoi(argv[2]) : 11;
+    const double tolerance = argc > 3 ? std::stod(argv[3]) : 1e-6;
+    std::cout << size << "x" << size << " cable net, lift 0.5 to 1.5 in " << steps << " steps, displacement tolerance "
+              << tolerance << std::endl;
+
+    Run cold, warm, predicted, previous;
+    unsigned int coldIterations = 0, warmIterations = 0, predictedIterations = 0;
+    double coldMs = 0.0, warmMs = 0.0, predictedMs = 0.0, difference = 0.0;
+    for (int k = 0; k < steps; ++k) {
+        const double lift = 0.5 + (steps > 1 ? double(k) / (steps - 1) : 0.0);
+        cold = solve(size, lift, tolerance, nullptr);
+        ShapeOp::ExtendedSolver::WarmStart prediction;
+        if (k > 1) {
+            prediction = predicted.state;
+            prediction.points = 2.0 * predicted.state.points - previous.state.points;
+        }
+        warm = solve(size, lift, tolerance, k > 0 ? &warm.state : nullptr);
+        previous = predicted;
+        predicted = solve(size, lift, tolerance, k > 1 ? &prediction : k > 0 ? &previous.state : nullptr);
+        coldIterations += cold.iterations;
+        warmIterations += warm.iterations;
+        predictedIterations += predicted.iterations;
+        coldMs += cold.ms;
+        warmMs += warm.ms;
+        predictedMs += predicted.ms;
+        for (const Run *run : {&warm, &predicted}) {
+            difference = std::max<double>(difference, (cold.state.points - run->state.points).cwiseAbs().maxCoeff());
+        }
+        std::cout << "lift " << std::fixed << std::setprecision(2) << lift << std::defaultfloat << std::setprecision(6)
+                  << ": cold " << cold.iterations << " iterations " << cold.ms << " ms, warm " << warm.iterations
+                  << " iterations " << warm.ms << " ms, predicted " << predicted.iterations << " iterations "
+                  << predicted.ms << " ms" << std::endl;
+    }
+    std::cout << "total: cold " << coldIterations << " iterations " << coldMs << " ms, warm " << warmIterations
+              << " iterations " << warmMs << " ms, predicted " << predictedIterations << " iterations "
+              << predictedMs << " ms" << std::endl;
+    std::cout << "max difference to the cold solutions: " << difference << std::endl;
+
+    // Same points and size, different matrix: initialize() must factorize anew
+    const double lift = steps > 1 ? 1.5 : 0.5;
+    cold = solve(size, lift, tolerance, nullptr, 1e3);
+    warm = solve(size, lift, tolerance, &warm.state, 1e3);
+    const double weightDifference = (cold.state.points - warm.state.points).cwiseAbs().maxCoeff();
+    std::cout << "pin weight 1e3 from the last warm start: " << warm.iterations << " iterations, difference "
+              << weightDifference << std::endl;
+    return weightDifference <= std::max(10.0 * difference, 1e-3) ? 0 : 1;
+}
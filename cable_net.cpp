@@ -1,9 +1,9 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <memory>
 #include <cmath>
 #include "pch.h"
+#include "MeshIO.h"
 
 int main() {
     // Create a simple cable net structure
@@ -142,31 +142,12 @@ int main() {
     const ShapeOp::Matrix3X& final_points = solver.getPoints();
     
     // Write the result to an OBJ file for visualization
-    std::ofstream objFile("cable_net.obj");
-    
-    // Write vertices
-    for (int i = 0; i < rows * cols; ++i) {
-        objFile << "v " 
-                << final_points(0, i) << " " 
-                << final_points(1, i) << " " 
-                << final_points(2, i) << std::endl;
+    try {
+        ShapeOp::writeOBJ("cable_net.obj", ShapeOp::gridMesh(final_points, rows, cols));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
-    
-    // Write faces as quads (instead of triangles)
-    for (int y = 0; y < rows - 1; ++y) {
-        for (int x = 0; x < cols - 1; ++x) {
-            // Get the four corners of the quad (in counter-clockwise order)
-            int i00 = index(x, y) + 1;       // bottom-left  (+1 because OBJ indices start at 1)
-            int i10 = index(x+1, y) + 1;     // bottom-right
-            int i11 = index(x+1, y+1) + 1;   // top-right
-            int i01 = index(x, y+1) + 1;     // top-left
-            
-            // Write a single quad face with 4 vertices
-            objFile << "f " << i00 << " " << i10 << " " << i11 << " " << i01 << std::endl;
-        }
-    }
-    
-    objFile.close();
     std::cout << "Wrote cable_net.obj" << std::endl;
     
     return 0;
@@ -0,0 +1,41 @@
+#include "BatchForce.h"
+
+namespace ShapeOp {
+
+void BatchForce::addForces(const Matrix3X &positions, Matrix3X &out) const {
+    for (int i = 0; i < static_cast<int>(positions.cols()); ++i) {
+        out.col(i) += get(positions, i);
+    }
+}
+
+Vector3 FieldForce::get(const Matrix3X &, int id) const {
+    return forces.col(id);
+}
+
+void FieldForce::addForces(const Matrix3X &, Matrix3X &out) const {
+    out += forces;
+}
+
+void addForces(const Force &force, const Matrix3X &positions, Matrix3X &out) {
+    const int n = static_cast<int>(positions.cols());
+
+    if (auto batch = dynamic_cast<const BatchForce *>(&force)) {
+        batch->addForces(positions, out);
+    } else if (auto gravity = dynamic_cast<const GravityForce *>(&force)) {
+        // Gravity does not depend on the vertex, so one evaluation covers all of them
+        if (n > 0) {
+            out.colwise() += gravity->get(positions, 0);
+        }
+    } else if (auto vertex = dynamic_cast<const VertexForce *>(&force)) {
+        // VertexForce::get is final, so these calls are resolved statically
+        for (int i = 0; i < n; ++i) {
+            out.col(i) += vertex->get(positions, i);
+        }
+    } else {
+        for (int i = 0; i < n; ++i) {
+            out.col(i) += force.get(positions, i);
+        }
+    }
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Force.h"
+#include "Types.h"
+
+namespace ShapeOp {
+
+// Force that can fill the whole force matrix in one call instead of one virtual get() per vertex.
+class BatchForce : public Force {
+public:
+    // Adds the force acting on every vertex to out (3 x n, same layout as positions).
+    // The default falls back to the per-vertex get() loop.
+    virtual void addForces(const Matrix3X &positions, Matrix3X &out) const;
+};
+
+// A given force per vertex, one column each, such as a field computed elsewhere
+class FieldForce : public BatchForce {
+public:
+    virtual Vector3 get(const Matrix3X &positions, int id) const override;
+    virtual void addForces(const Matrix3X &positions, Matrix3X &out) const override;
+
+    Matrix3X forces;
+};
+
+// Adds any force to out in one call: BatchForce uses its native path, GravityForce is
+// evaluated once and broadcast, VertexForce is called without virtual dispatch, and any
+// other Force falls back to the per-vertex loop.
+void addForces(const Force &force, const Matrix3X &positions, Matrix3X &out);
+
+} // namespace ShapeOp
@@ -0,0 +1,164 @@
+#include "Coarsening.h"
+#include <Eigen/QR>
+#include <algorithm>
+#include <cmath>
+
+namespace ShapeOp {
+
+namespace {
+
+// Linear interpolation along one axis of n vertices from every other one plus the last:
+// for each fine index its two coarse neighbours and the weight of the second
+struct Axis {
+    std::vector<int> nodes;
+    std::vector<int> below;
+    std::vector<GlobalScalar> t;
+
+    explicit Axis(int n) {
+        for (int i = 0; i < n; i += 2) {
+            nodes.push_back(i);
+        }
+        if (nodes.back() != n - 1) {
+            nodes.push_back(n - 1);
+        }
+        below.resize(n);
+        t.resize(n);
+        int k = 0;
+        for (int i = 0; i < n; ++i) {
+            while (k + 1 < static_cast<int>(nodes.size()) && nodes[k + 1] <= i) {
+                ++k;
+            }
+            below[i] = k;
+            t[i] = nodes[k] == i ? 0.0 : GlobalScalar(i - nodes[k]) / (nodes[k + 1] - nodes[k]);
+        }
+    }
+
+    int nearest(int i) const { return t[i] > 0.5 ? below[i] + 1 : below[i]; }
+};
+
+} // namespace
+
+Coarsening coarsenGrid(int rows, int cols) {
+    const Axis y(rows), x(cols);
+    Coarsening c;
+    c.rows = static_cast<int>(y.nodes.size());
+    c.cols = static_cast<int>(x.nodes.size());
+    for (int cy = 0; cy < c.rows; ++cy) {
+        for (int cx = 0; cx < c.cols; ++cx) {
+            c.seeds.push_back(y.nodes[cy] * cols + x.nodes[cx]);
+        }
+    }
+
+    std::vector<Eigen::Triplet<GlobalScalar>> triplets;
+    triplets.reserve(4 * rows * cols);
+    c.aggregate.resize(rows * cols);
+    for (int fy = 0; fy < rows; ++fy) {
+        for (int fx = 0; fx < cols; ++fx) {
+            const int v = fy * cols + fx;
+            c.aggregate[v] = y.nearest(fy) * c.cols + x.nearest(fx);
+            for (int dy = 0; dy < 2; ++dy) {
+                const GlobalScalar wy = dy ? y.t[fy] : 1.0 - y.t[fy];
+                for (int dx = 0; dx < 2; ++dx) {
+                    const GlobalScalar wx = dx ? x.t[fx] : 1.0 - x.t[fx];
+                    if (wy * wx > 0.0) {
+                        triplets.emplace_back(v, (y.below[fy] + dy) * c.cols + x.below[fx] + dx, wy * wx);
+                    }
+                }
+            }
+        }
+    }
+    c.prolongation.resize(rows * cols, c.rows * c.cols);
+    c.prolongation.setFromTriplets(triplets.begin(), triplets.end());
+    return c;
+}
+
+Coarsening coarsenGraph(const GlobalSparseMatrix &matrix, const Matrix3X &points, const std::vector<int> &first) {
+    const int n = static_cast<int>(matrix.cols());
+    Coarsening c;
+    c.aggregate.assign(n, -1);
+
+    // Aggregates of a vertex and all its neighbours, none of them taken yet
+    auto seed = [&](int v) {
+        if (c.aggregate[v] >= 0) {
+            return;
+        }
+        for (GlobalSparseMatrix::InnerIterator it(matrix, v); it; ++it) {
+            if (c.aggregate[it.index()] >= 0) {
+                return;
+            }
+        }
+        const int a = static_cast<int>(c.seeds.size());
+        c.seeds.push_back(v);
+        for (GlobalSparseMatrix::InnerIterator it(matrix, v); it; ++it) {
+            c.aggregate[it.index()] = a;
+        }
+        c.aggregate[v] = a;
+    };
+    for (int v : first) {
+        seed(v);
+    }
+    for (int v = 0; v < n; ++v) {
+        seed(v);
+    }
+
+    // Leftovers join the aggregate they couple to most strongly, or start their own
+    const std::vector<int> seeded = c.aggregate;
+    for (int v = 0; v < n; ++v) {
+        if (seeded[v] >= 0) {
+            continue;
+        }
+        GlobalScalar strongest = 0.0;
+        for (GlobalSparseMatrix::InnerIterator it(matrix, v); it; ++it) {
+            if (it.index() != v && seeded[it.index()] >= 0 && std::abs(it.value()) > strongest) {
+                strongest = std::abs(it.value());
+                c.aggregate[v] = seeded[it.index()];
+            }
+        }
+        if (c.aggregate[v] < 0) {
+            c.aggregate[v] = static_cast<int>(c.seeds.size());
+            c.seeds.push_back(v);
+        }
+    }
+
+    // Neighbouring aggregates, which with a vertex's own one supply its interpolation points
+    const int coarse = static_cast<int>(c.seeds.size());
+    std::vector<std::vector<int>> adjacent(coarse);
+    for (int v = 0; v < n; ++v) {
+        for (GlobalSparseMatrix::InnerIterator it(matrix, v); it; ++it) {
+            if (c.aggregate[it.index()] != c.aggregate[v]) {
+                adjacent[c.aggregate[v]].push_back(c.aggregate[it.index()]);
+            }
+        }
+    }
+    for (std::vector<int> &list : adjacent) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    // Minimum norm weights that reproduce the vertex's position as an affine combination
+    // of the seeds' ones, so that translations and linear deformations interpolate exactly
+    std::vector<Eigen::Triplet<GlobalScalar>> triplets;
+    triplets.reserve(7 * n);
+    for (int v = 0; v < n; ++v) {
+        const int own = c.aggregate[v];
+        const int count = 1 + static_cast<int>(adjacent[own].size());
+        GlobalMatrixXX support(4, count);
+        for (int k = 0; k < count; ++k) {
+            const int a = k == 0 ? own : adjacent[own][k - 1];
+            support.col(k) << points.col(c.seeds[a]).cast<GlobalScalar>(), 1.0;
+        }
+        Eigen::Matrix<GlobalScalar, 4, 1> target;
+        target << points.col(v).cast<GlobalScalar>(), 1.0;
+        const GlobalVectorX weights = support.completeOrthogonalDecomposition().solve(target);
+        for (int k = 0; k < count; ++k) {
+            if (std::abs(weights(k)) > 1e-12) {
+                triplets.emplace_back(v, k == 0 ? own : adjacent[own][k - 1], weights(k));
+            }
+        }
+    }
+    c.prolongation.resize(n, coarse);
+    c.prolongation.setFromTriplets(triplets.begin(), triplets.end());
+    return c;
+}
+
+} // namespace ShapeOp
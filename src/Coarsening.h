@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Precision.h"
+#include <vector>
+
+namespace ShapeOp {
+
+// One coarsening step of ExtendedSolver's hierarchy: which fine vertices become the
+// coarse level's vertices, and how coarse corrections are interpolated back
+struct Coarsening {
+    std::vector<int> seeds;          // Fine vertex per coarse vertex, whose point it takes
+    std::vector<int> aggregate;      // Coarse vertex per fine vertex it belongs to
+    GlobalSparseMatrix prolongation; // Fine x coarse interpolation of corrections
+    int rows = 0;                    // Coarse grid size, for grid coarsening
+    int cols = 0;
+};
+
+// Geometric coarsening of a rows x cols grid of vertices numbered row-major (y * cols + x):
+// every other row and column, always including the last ones, with bilinear interpolation.
+// Each fine vertex belongs to its nearest coarse vertex.
+Coarsening coarsenGrid(int rows, int cols);
+
+// Aggregation on the graph of matrix's off-diagonal nonzeros (symmetric, such as the
+// global matrix N), for meshes without grid structure. Vertices are grouped greedily with
+// their untaken neighbours, first (pins) before the rest in order; leftovers join their
+// most strongly coupled aggregate. Each vertex interpolates from the seeds of its own and
+// the adjacent aggregates with the minimum norm weights reproducing its position in points.
+Coarsening coarsenGraph(const GlobalSparseMatrix &matrix, const Matrix3X &points, const std::vector<int> &first);
+
+} // namespace ShapeOp
@@ -0,0 +1,105 @@
+#include "ConstraintBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace ShapeOp {
+
+ConstraintBuilder::ConstraintBuilder(const Matrix3X &positions, std::pmr::memory_resource *resource)
+    : positions_(positions), resource_(resource) {}
+
+std::shared_ptr<EdgeStrainBlock> ConstraintBuilder::edgeStrainBlock(const Eigen::Matrix2Xi &edges, Scalar weight,
+                                                                    Scalar rangeMin, Scalar rangeMax) const {
+    return std::make_shared<EdgeStrainBlock>(edges, weight, positions_, rangeMin, rangeMax);
+}
+
+std::shared_ptr<EdgeStrainBlock> ConstraintBuilder::edgeStrainBlock(const Eigen::Matrix2Xi &edges,
+                                                                    const VectorX &weights,
+                                                                    const VectorX &rangeMin,
+                                                                    const VectorX &rangeMax) const {
+    return std::make_shared<EdgeStrainBlock>(edges, weights, positions_, rangeMin, rangeMax);
+}
+
+template <typename T, typename Make>
+void ConstraintBuilder::build(int count, Make make, std::vector<std::shared_ptr<Constraint>> &out) const {
+    // One reservation for all constraints; emplacing never reallocates, so the
+    // aliasing pointers below stay valid for the pool's lifetime
+    std::pmr::polymorphic_allocator<T> alloc(resource_);
+    auto pool = std::allocate_shared<std::pmr::vector<T>>(alloc);
+    pool->reserve(count);
+
+    out.reserve(out.size() + count);
+    for (int k = 0; k < count; ++k) {
+        make(*pool, k);
+        out.emplace_back(pool, &pool->back());
+    }
+}
+
+void ConstraintBuilder::edgeStrain(const Eigen::Matrix2Xi &edges, Scalar weight, Scalar rangeMin, Scalar rangeMax,
+                                   std::vector<std::shared_ptr<Constraint>> &out) const {
+    std::vector<int> idI(2);
+    build<EdgeStrainConstraint>(static_cast<int>(edges.cols()), [&](auto &pool, int k) {
+        idI[0] = edges(0, k);
+        idI[1] = edges(1, k);
+        pool.emplace_back(idI, weight, positions_, rangeMin, rangeMax);
+    }, out);
+}
+
+void ConstraintBuilder::edgeStrain(const Eigen::Matrix2Xi &edges, const VectorX &weights, const VectorX &rangeMin,
+                                   const VectorX &rangeMax, std::vector<std::shared_ptr<Constraint>> &out) const {
+    assert(weights.size() == edges.cols() && rangeMin.size() == edges.cols() && rangeMax.size() == edges.cols());
+    std::vector<int> idI(2);
+    build<EdgeStrainConstraint>(static_cast<int>(edges.cols()), [&](auto &pool, int k) {
+        idI[0] = edges(0, k);
+        idI[1] = edges(1, k);
+        pool.emplace_back(idI, weights(k), positions_, rangeMin(k), rangeMax(k));
+    }, out);
+}
+
+void ConstraintBuilder::closeness(const Eigen::VectorXi &ids, Scalar weight,
+                                  std::vector<std::shared_ptr<Constraint>> &out) const {
+    std::vector<int> idI(1);
+    build<ClosenessConstraint>(static_cast<int>(ids.size()), [&](auto &pool, int k) {
+        idI[0] = ids(k);
+        pool.emplace_back(idI, weight, positions_);
+    }, out);
+}
+
+void ConstraintBuilder::closeness(const Eigen::VectorXi &ids, const VectorX &weights,
+                                  std::vector<std::shared_ptr<Constraint>> &out) const {
+    assert(weights.size() == ids.size());
+    std::vector<int> idI(1);
+    build<ClosenessConstraint>(static_cast<int>(ids.size()), [&](auto &pool, int k) {
+        idI[0] = ids(k);
+        pool.emplace_back(idI, weights(k), positions_);
+    }, out);
+}
+
+Eigen::Matrix2Xi ConstraintBuilder::uniqueEdges(const std::vector<std::vector<int>> &faces) {
+    // (key, position) per face edge; sort, keep the first occurrence of each key,
+    // then restore face traversal order
+    std::vector<std::pair<std::uint64_t, std::size_t>> keyed;
+    for (const auto &face : faces) {
+        for (size_t i = 0; i < face.size(); ++i) {
+            auto a = static_cast<std::uint32_t>(face[i]);
+            auto b = static_cast<std::uint32_t>(face[(i + 1) % face.size()]);
+            if (a > b) std::swap(a, b);
+            keyed.emplace_back((static_cast<std::uint64_t>(a) << 32) | b, keyed.size());
+        }
+    }
+    std::sort(keyed.begin(), keyed.end());
+    keyed.erase(std::unique(keyed.begin(), keyed.end(),
+                            [](const auto &x, const auto &y) { return x.first == y.first; }),
+                keyed.end());
+    std::sort(keyed.begin(), keyed.end(), [](const auto &x, const auto &y) { return x.second < y.second; });
+
+    Eigen::Matrix2Xi edges(2, keyed.size());
+    for (size_t e = 0; e < keyed.size(); ++e) {
+        edges(0, e) = static_cast<int>(keyed[e].first >> 32);
+        edges(1, e) = static_cast<int>(keyed[e].first & 0xffffffffu);
+    }
+    return edges;
+}
+
+} // namespace ShapeOp
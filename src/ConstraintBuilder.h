@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Constraint.h"
+#include "EdgeStrainBlock.h"
+#include "Types.h"
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace ShapeOp {
+
+// Builds constraints in bulk from flat index arrays instead of one
+// std::vector + make_shared per element.
+//
+// Individual constraints of one call are emplaced into a single pool array reserved
+// up front, and handed out as aliasing shared_ptrs that share the pool's one control
+// block; the pool is freed when the last of them goes away. Pool storage comes from
+// the given memory resource, which must outlive the constraints.
+class ConstraintBuilder {
+public:
+    // positions are the rest state constraints are built from, as with solver.getPoints(),
+    // and must outlive the builder
+    explicit ConstraintBuilder(const Matrix3X &positions,
+                               std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // All edges as one packed constraint (the cheapest option)
+    std::shared_ptr<EdgeStrainBlock> edgeStrainBlock(const Eigen::Matrix2Xi &edges, Scalar weight,
+                                                     Scalar rangeMin = 1.0, Scalar rangeMax = 1.0) const;
+    std::shared_ptr<EdgeStrainBlock> edgeStrainBlock(const Eigen::Matrix2Xi &edges, const VectorX &weights,
+                                                     const VectorX &rangeMin, const VectorX &rangeMax) const;
+
+    // One EdgeStrainConstraint per edge from a single pool, appended to out
+    void edgeStrain(const Eigen::Matrix2Xi &edges, Scalar weight, Scalar rangeMin, Scalar rangeMax,
+                    std::vector<std::shared_ptr<Constraint>> &out) const;
+    void edgeStrain(const Eigen::Matrix2Xi &edges, const VectorX &weights, const VectorX &rangeMin,
+                    const VectorX &rangeMax, std::vector<std::shared_ptr<Constraint>> &out) const;
+
+    // One ClosenessConstraint per vertex from a single pool, appended to out
+    void closeness(const Eigen::VectorXi &ids, Scalar weight, std::vector<std::shared_ptr<Constraint>> &out) const;
+    void closeness(const Eigen::VectorXi &ids, const VectorX &weights,
+                   std::vector<std::shared_ptr<Constraint>> &out) const;
+
+    // Unique undirected edges of a face list, (min, max) per column, in order of first appearance
+    static Eigen::Matrix2Xi uniqueEdges(const std::vector<std::vector<int>> &faces);
+
+private:
+    template <typename T, typename Make>
+    void build(int count, Make make, std::vector<std::shared_ptr<Constraint>> &out) const;
+
+    const Matrix3X &positions_;
+    std::pmr::memory_resource *resource_;
+};
+
+// Adds a batch of constraints to any solver with ShapeOp::Solver's addConstraint
+template <typename SolverT>
+void addConstraints(SolverT &solver, const std::vector<std::shared_ptr<Constraint>> &constraints) {
+    for (const auto &c : constraints) {
+        solver.addConstraint(c);
+    }
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,356 @@
+#include "ContactConstraint.h"
+#include "ConstraintBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+namespace ShapeOp {
+
+namespace {
+
+// Barycentric coordinates of the point of triangle abc closest to p (Ericson,
+// "Real-Time Collision Detection", 5.1.5)
+Vector3 closestOnTriangle(const Vector3 &p, const Vector3 &a, const Vector3 &b, const Vector3 &c) {
+    const Vector3 ab = b - a, ac = c - a, ap = p - a;
+    const Scalar d1 = ab.dot(ap), d2 = ac.dot(ap);
+    if (d1 <= 0.0 && d2 <= 0.0) return Vector3(1.0, 0.0, 0.0);
+    const Vector3 bp = p - b;
+    const Scalar d3 = ab.dot(bp), d4 = ac.dot(bp);
+    if (d3 >= 0.0 && d4 <= d3) return Vector3(0.0, 1.0, 0.0);
+    const Scalar vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+        const Scalar v = d1 / (d1 - d3);
+        return Vector3(1.0 - v, v, 0.0);
+    }
+    const Vector3 cp = p - c;
+    const Scalar d5 = ab.dot(cp), d6 = ac.dot(cp);
+    if (d6 >= 0.0 && d5 <= d6) return Vector3(0.0, 0.0, 1.0);
+    const Scalar vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+        const Scalar w = d2 / (d2 - d6);
+        return Vector3(1.0 - w, 0.0, w);
+    }
+    const Scalar va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) {
+        const Scalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return Vector3(0.0, 1.0 - w, w);
+    }
+    const Scalar denominator = 1.0 / (va + vb + vc);
+    const Scalar v = vb * denominator, w = vc * denominator;
+    return Vector3(1.0 - v - w, v, w);
+}
+
+// Parameters s, t of the closest points p1 + s (q1 - p1) and p2 + t (q2 - p2) of two
+// segments (Ericson, 5.1.9)
+void closestOnSegments(const Vector3 &p1, const Vector3 &q1, const Vector3 &p2, const Vector3 &q2, Scalar &s,
+                       Scalar &t) {
+    const Vector3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    const Scalar a = d1.squaredNorm(), e = d2.squaredNorm(), f = d2.dot(r);
+    const Scalar c = d1.dot(r), b = d1.dot(d2);
+    const Scalar denominator = a * e - b * b;
+    s = denominator > 0.0 ? std::clamp<Scalar>((b * f - c * e) / denominator, 0.0, 1.0) : 0.0;
+    t = (b * s + f) / e;
+    if (t < 0.0) {
+        t = 0.0;
+        s = std::clamp<Scalar>(-c / a, 0.0, 1.0);
+    } else if (t > 1.0) {
+        t = 1.0;
+        s = std::clamp<Scalar>((b - c) / a, 0.0, 1.0);
+    }
+}
+
+Eigen::Matrix3Xi triangulate(const std::vector<std::vector<int>> &faces) {
+    int count = 0;
+    for (const auto &face : faces) {
+        count += std::max(0, static_cast<int>(face.size()) - 2);
+    }
+    Eigen::Matrix3Xi triangles(3, count);
+    int t = 0;
+    for (const auto &face : faces) {
+        for (size_t k = 2; k < face.size(); ++k) {
+            triangles.col(t++) << face[0], face[k - 1], face[k];
+        }
+    }
+    return triangles;
+}
+
+// Runs find(i, found, candidates) for every i in [0, n), in parallel with SHAPEOP_OPENMP,
+// on each thread's Scratch; found comes out in the order of i whatever the thread count
+template <typename Item, typename Scratch, typename Find>
+void gather(int n, std::vector<Item> &found, std::vector<Scratch> &scratch, Find &&find) {
+    int threads = 1;
+#ifdef SHAPEOP_OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (static_cast<int>(scratch.size()) < threads) {
+        scratch.resize(threads);
+        for (Scratch &s : scratch) {
+            // Queries return tens of candidates; with room for far more up front they
+            // practically never grow
+            s.candidates.reserve(1024);
+        }
+    }
+#ifdef SHAPEOP_OPENMP
+    // The team can be smaller than omp_get_max_threads() (nested in ShapeOp::Solver's
+    // parallel projection, or under OMP_DYNAMIC), so only its own threads' results merge
+    int team = 1;
+#pragma omp parallel
+    {
+        Scratch &mine = scratch[omp_get_thread_num()];
+        mine.found.clear();
+#pragma omp single nowait
+        team = omp_get_num_threads();
+#pragma omp for schedule(static)
+        for (int i = 0; i < n; ++i) {
+            find(i, mine.found, mine.candidates);
+        }
+    }
+    for (int t = 0; t < team; ++t) {
+        found.insert(found.end(), scratch[t].found.begin(), scratch[t].found.end());
+    }
+#else
+    for (int i = 0; i < n; ++i) {
+        find(i, found, scratch[0].candidates);
+    }
+#endif
+}
+
+} // namespace
+
+ContactConstraint::ContactConstraint(const std::vector<std::vector<int>> &faces,
+                                     Scalar weight,
+                                     const Matrix3X &positions,
+                                     Scalar thickness)
+    : Constraint(std::vector<int>(), weight), thickness_(thickness) {
+    triangles_ = triangulate(faces);
+    rowOf_.assign(positions.cols(), -1);
+    for (Eigen::Index k = 0; k < triangles_.size(); ++k) {
+        int &row = rowOf_[triangles_(k)];
+        if (row < 0) {
+            row = static_cast<int>(vertices_.size());
+            vertices_.push_back(triangles_(k));
+        }
+        triangles_(k) = row;
+    }
+    idI_ = vertices_;
+    inContact_.assign(vertices_.size(), 0);
+    assembled_ = inContact_;
+    edges_ = ConstraintBuilder::uniqueEdges(faces);
+    Scalar length = 0.0;
+    for (int e = 0; e < nEdges(); ++e) {
+        length += (positions.col(edges_(1, e)) - positions.col(edges_(0, e))).norm();
+        edges_(0, e) = rowOf_[edges_(0, e)];
+        edges_(1, e) = rowOf_[edges_(1, e)];
+    }
+
+    // Cells about one triangle across
+    const Scalar cell = (nEdges() > 0 ? length / nEdges() : Scalar(1.0)) + thickness_;
+    triangleHash_.setCellSize(cell);
+    edgeHash_.setCellSize(cell);
+    obstacleHash_.setCellSize(cell);
+}
+
+void ContactConstraint::setObstacle(const Matrix3X &points, const std::vector<std::vector<int>> &faces) {
+    obstaclePoints_ = points;
+    obstacleTriangles_ = triangulate(faces);
+    const int n = static_cast<int>(obstacleTriangles_.cols());
+    Matrix3X lower(3, n), upper(3, n);
+    for (int t = 0; t < n; ++t) {
+        const Vector3 &a = obstaclePoints_.col(obstacleTriangles_(0, t));
+        const Vector3 &b = obstaclePoints_.col(obstacleTriangles_(1, t));
+        const Vector3 &c = obstaclePoints_.col(obstacleTriangles_(2, t));
+        lower.col(t) = a.cwiseMin(b).cwiseMin(c).array() - thickness_;
+        upper.col(t) = a.cwiseMax(b).cwiseMax(c).array() + thickness_;
+    }
+    obstacleHash_.build(lower, upper);
+}
+
+void ContactConstraint::detect(const Matrix3X &positions) const {
+    const int n = static_cast<int>(vertices_.size());
+    points_.resize(3, n);
+    for (int r = 0; r < n; ++r) {
+        points_.col(r) = positions.col(vertices_[r]);
+    }
+
+    // Broad phase: triangles grown by thickness against vertices, edges grown by half of
+    // it against each other
+    triangleLower_.resize(3, nTriangles());
+    triangleUpper_.resize(3, nTriangles());
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int t = 0; t < nTriangles(); ++t) {
+        const Vector3 &a = points_.col(triangles_(0, t));
+        const Vector3 &b = points_.col(triangles_(1, t));
+        const Vector3 &c = points_.col(triangles_(2, t));
+        triangleLower_.col(t) = a.cwiseMin(b).cwiseMin(c).array() - thickness_;
+        triangleUpper_.col(t) = a.cwiseMax(b).cwiseMax(c).array() + thickness_;
+    }
+    triangleHash_.build(triangleLower_, triangleUpper_);
+    edgeLower_.resize(3, nEdges());
+    edgeUpper_.resize(3, nEdges());
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int e = 0; e < nEdges(); ++e) {
+        const Vector3 &a = points_.col(edges_(0, e));
+        const Vector3 &b = points_.col(edges_(1, e));
+        edgeLower_.col(e) = a.cwiseMin(b).array() - 0.5 * thickness_;
+        edgeUpper_.col(e) = a.cwiseMax(b).array() + 0.5 * thickness_;
+    }
+    edgeHash_.build(edgeLower_, edgeUpper_);
+
+    // Narrow phase
+    contacts_.clear();
+    findVertexTriangle(contacts_);
+    counts_.vertexTriangle = static_cast<int>(contacts_.size());
+    findEdgeEdge(contacts_);
+    counts_.edgeEdge = static_cast<int>(contacts_.size()) - counts_.vertexTriangle;
+    findObstacle(contacts_);
+    counts_.obstacle = static_cast<int>(contacts_.size()) - counts_.vertexTriangle - counts_.edgeEdge;
+
+    // Each contact moves its two sides apart by depth, half each (all of it for a
+    // vertex against an obstacle), spread over the rows by their weights so the contact
+    // points themselves move that far; rows average over their contacts
+    shifts_.setZero(3, n);
+    shiftCounts_.assign(n, 0);
+    for (const Contact &contact : contacts_) {
+        Scalar side[2] = {0.0, 0.0};
+        for (int k = 0; k < contact.count; ++k) {
+            side[k >= contact.firstSide] += contact.weights[k] * contact.weights[k];
+        }
+        const Scalar share = contact.firstSide == contact.count ? contact.depth : 0.5 * contact.depth;
+        for (int k = 0; k < contact.count; ++k) {
+            const int s = k >= contact.firstSide;
+            if (side[s] <= 0.0) continue;
+            const Scalar amount = (s ? -share : share) * contact.weights[k] / side[s];
+            shifts_.col(contact.rows[k]) += amount * contact.normal;
+            ++shiftCounts_[contact.rows[k]];
+        }
+    }
+    targets_ = points_;
+    counts_.switched = 0;
+    for (int r = 0; r < n; ++r) {
+        inContact_[r] = shiftCounts_[r] > 0;
+        counts_.switched += inContact_[r] != assembled_[r];
+        if (inContact_[r]) {
+            targets_.col(r) += shifts_.col(r) / Scalar(shiftCounts_[r]);
+        }
+    }
+    switches_ += counts_.switched;
+    detected_ = positions;
+}
+
+void ContactConstraint::findVertexTriangle(std::vector<Contact> &contacts) const {
+    gather(static_cast<int>(vertices_.size()), contacts, scratch_,
+           [this](int v, std::vector<Contact> &found, std::vector<int> &candidates) {
+        const Vector3 &p = points_.col(v);
+        candidates.clear();
+        triangleHash_.query(p, p, candidates);
+        for (int t : candidates) {
+            const int a = triangles_(0, t), b = triangles_(1, t), c = triangles_(2, t);
+            if (v == a || v == b || v == c) continue;
+            const Vector3 weights = closestOnTriangle(p, points_.col(a), points_.col(b), points_.col(c));
+            const Vector3 offset = p - (weights(0) * points_.col(a) + weights(1) * points_.col(b) +
+                                        weights(2) * points_.col(c));
+            const Scalar distance = offset.norm();
+            if (distance >= thickness_) continue;
+            Vector3 normal = offset / distance;
+            if (!(distance > 0.0)) {
+                normal = (points_.col(b) - points_.col(a)).cross(points_.col(c) - points_.col(a)).normalized();
+            }
+            found.push_back({{v, a, b, c}, {1.0, weights(0), weights(1), weights(2)}, 4, 1, normal,
+                             thickness_ - distance});
+        }
+    });
+}
+
+void ContactConstraint::findEdgeEdge(std::vector<Contact> &contacts) const {
+    gather(nEdges(), contacts, scratch_, [this](int e, std::vector<Contact> &found, std::vector<int> &candidates) {
+        const int a = edges_(0, e), b = edges_(1, e);
+        const Vector3 &pa = points_.col(a), &pb = points_.col(b);
+        const Vector3 grow = Vector3::Constant(0.5 * thickness_);
+        candidates.clear();
+        edgeHash_.query(pa.cwiseMin(pb) - grow, pa.cwiseMax(pb) + grow, candidates);
+        for (int f : candidates) {
+            const int c = edges_(0, f), d = edges_(1, f);
+            if (f <= e || c == a || c == b || d == a || d == b) continue;
+            const Vector3 &pc = points_.col(c), &pd = points_.col(d);
+            Scalar s, t;
+            closestOnSegments(pa, pb, pc, pd, s, t);
+            const Vector3 offset = (pa + s * (pb - pa)) - (pc + t * (pd - pc));
+            const Scalar distance = offset.norm();
+            if (distance >= thickness_) continue;
+            Vector3 normal = offset / distance;
+            if (!(distance > 0.0)) {
+                normal = (pb - pa).cross(pd - pc);
+                if (!(normal.squaredNorm() > 0.0)) continue;
+                normal.normalize();
+            }
+            found.push_back({{a, b, c, d}, {1 - s, s, 1 - t, t}, 4, 2, normal, thickness_ - distance});
+        }
+    });
+}
+
+void ContactConstraint::findObstacle(std::vector<Contact> &contacts) const {
+    if (obstacleTriangles_.cols() == 0) return;
+    gather(static_cast<int>(vertices_.size()), contacts, scratch_,
+           [this](int v, std::vector<Contact> &found, std::vector<int> &candidates) {
+        const Vector3 &p = points_.col(v);
+        candidates.clear();
+        obstacleHash_.query(p, p, candidates);
+        // The nearest triangle decides, so a vertex near an edge of the obstacle isn't
+        // pushed out of two faces at once
+        Scalar nearest = thickness_;
+        Vector3 target = p;
+        for (int t : candidates) {
+            const Vector3 &a = obstaclePoints_.col(obstacleTriangles_(0, t));
+            const Vector3 &b = obstaclePoints_.col(obstacleTriangles_(1, t));
+            const Vector3 &c = obstaclePoints_.col(obstacleTriangles_(2, t));
+            const Vector3 weights = closestOnTriangle(p, a, b, c);
+            const Vector3 closest = weights(0) * a + weights(1) * b + weights(2) * c;
+            const Scalar distance = (p - closest).norm();
+            if (distance >= nearest) continue;
+            const Vector3 normal = (b - a).cross(c - a).normalized();
+            // Within thickness of the face, in front of it or behind it; deeper vertices
+            // aren't in the hashed boxes at all
+            nearest = distance;
+            target = closest + thickness_ * ((p - closest).dot(normal) < 0.0 || !(distance > 0.0)
+                                                  ? normal
+                                                  : Vector3((p - closest) / distance));
+        }
+        if (nearest < thickness_) {
+            const Vector3 push = target - p;
+            const Scalar depth = push.norm();
+            if (depth > 0.0) {
+                found.push_back({{v, 0, 0, 0}, {1.0, 0.0, 0.0, 0.0}, 1, 1, push / depth, depth});
+            }
+        }
+    });
+}
+
+void ContactConstraint::project(const Matrix3X &positions, Matrix3X &projections) const {
+    if (detected_.cols() != positions.cols() || detected_ != positions) {
+        detect(positions);
+    }
+    // Rows the matrix has switched off project to zero, so they add nothing to the
+    // right-hand side or the objective
+    for (int r = 0; r < static_cast<int>(vertices_.size()); ++r) {
+        projections.col(idO_ + r) = assembled_[r] ? Vector3(weight_ * targets_.col(r)) : Vector3::Zero();
+    }
+}
+
+void ContactConstraint::addConstraint(std::vector<Triplet> &triplets, int &idO) const {
+    // Every row is handed out, zero without a contact, so the structure never changes
+    idO_ = idO;
+    assembled_ = inContact_;
+    for (size_t r = 0; r < vertices_.size(); ++r) {
+        triplets.push_back(Triplet(idO_ + static_cast<int>(r), vertices_[r], assembled_[r] ? weight_ : Scalar(0.0)));
+    }
+    idO += static_cast<int>(vertices_.size());
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Constraint.h"
+#include "SpatialHash.h"
+#include "Types.h"
+#include <vector>
+
+namespace ShapeOp {
+
+// Self-contact of a mesh, and contact with a static obstacle mesh, as one constraint
+// with a closeness row per mesh vertex. Each local step rebuilds spatial hashes of the
+// triangles and edges (SpatialHash), finds vertex-triangle and edge-edge pairs closer
+// than thickness and obstacle triangles a vertex is within thickness of (in front or
+// behind; a vertex behind by more is not found), and targets each vertex at the average
+// of its contacts' separating positions, obstacle contacts on the normal side. Only the
+// rows of vertices in contact carry the weight; the others are zero, so a mesh without
+// contacts solves exactly as it would without the constraint. Rows keep their place in
+// the matrix when switched, and ExtendedSolver applies the switches as a low-rank update
+// (updateConstraints), refactorizing once enough have piled up. ShapeOp::Solver
+// assembles its matrix once, before any contact is found, so the constraint needs
+// ExtendedSolver. The weight is a contact stiffness: it only pulls vertices in contact,
+// but one far above the mesh's other weights (dynamic: mass / timestep^2) overshoots
+// when a solve takes few iterations.
+//
+// Contacts only see proximity, not motion: a vertex that crosses a mesh triangle by more
+// than thickness within one iteration is pushed out the far side, and one that ends up
+// deeper than thickness behind an obstacle stays there. Keep thickness above the
+// distance points move per iteration, and below the edge length.
+class ContactConstraint : public Constraint {
+public:
+    // faces: polygons (fan-triangulated) over positions, such as Mesh::faceList()
+    ContactConstraint(const std::vector<std::vector<int>> &faces,
+                      Scalar weight,
+                      const Matrix3X &positions,
+                      Scalar thickness);
+
+    // Static triangles that mesh vertices are kept outside of, on the side their normals
+    // (counterclockwise) face, as long as they never end up more than thickness behind
+    // one; replaces any previous obstacle
+    void setObstacle(const Matrix3X &points, const std::vector<std::vector<int>> &faces);
+
+    // Broad and narrow phase for positions. ExtendedSolver calls it before each local
+    // step, outside the parallel projection; project() calls it itself when handed
+    // positions it hasn't seen.
+    void detect(const Matrix3X &positions) const;
+
+    // Whether the vertices in contact differ from those whose rows addConstraint() last
+    // handed out with the weight, so the matrix needs updating
+    bool contactsChanged() const { return inContact_ != assembled_; }
+
+    virtual void project(const Matrix3X &positions, Matrix3X &projections) const override;
+    virtual void addConstraint(std::vector<Triplet> &triplets, int &idO) const override;
+
+    // Contacts found by the last detect(), and the rows it found coming into or out of
+    // contact against those last handed out
+    struct Counts {
+        int vertexTriangle = 0;
+        int edgeEdge = 0;
+        int obstacle = 0;
+        int switched = 0;
+    };
+    Counts getCounts() const { return counts_; }
+    long getSwitches() const { return switches_; } // Counts::switched over all detect() calls
+
+    int nTriangles() const { return static_cast<int>(triangles_.cols()); }
+    int nEdges() const { return static_cast<int>(edges_.cols()); }
+
+private:
+    // Pushes vertex rows apart along normal by depth, split by the weights of each side
+    struct Contact {
+        int rows[4];
+        Scalar weights[4];
+        int count;      // Rows used
+        int firstSide;  // Rows [0, firstSide) move along normal, the rest against it
+        Vector3 normal;
+        Scalar depth;
+    };
+
+    void findVertexTriangle(std::vector<Contact> &contacts) const;
+    void findEdgeEdge(std::vector<Contact> &contacts) const;
+    void findObstacle(std::vector<Contact> &contacts) const;
+
+    Scalar thickness_;
+    std::vector<int> vertices_;    // Mesh vertex per row
+    std::vector<int> rowOf_;       // Row per point index, -1 outside the mesh
+    Eigen::Matrix3Xi triangles_;   // Rows, not point indices
+    Eigen::Matrix2Xi edges_;       // Rows, unique
+
+    Matrix3X obstaclePoints_;
+    Eigen::Matrix3Xi obstacleTriangles_;
+    SpatialHash obstacleHash_;
+
+    // Narrow phase scratch of one thread
+    struct Scratch {
+        std::vector<Contact> found;
+        std::vector<int> candidates;
+    };
+
+    // Per-detection state, kept between detections so they stop allocating once the
+    // contact counts have peaked
+    mutable SpatialHash triangleHash_;
+    mutable SpatialHash edgeHash_;
+    mutable Matrix3X triangleLower_, triangleUpper_; // Boxes being hashed
+    mutable Matrix3X edgeLower_, edgeUpper_;
+    mutable Matrix3X points_;        // Mesh vertices' positions, by row
+    mutable Matrix3X targets_;       // Projection target per row
+    mutable Matrix3X detected_;      // Positions targets_ belong to
+    mutable Matrix3X shifts_;        // Summed contact shifts per row
+    mutable std::vector<int> shiftCounts_;
+    mutable std::vector<char> inContact_; // Per row, as of the last detect()
+    mutable std::vector<char> assembled_; // inContact_ as of the last addConstraint()
+    mutable std::vector<Contact> contacts_;
+    mutable std::vector<Scratch> scratch_;
+    mutable Counts counts_;
+    mutable long switches_ = 0;
+};
+
+} // namespace ShapeOp
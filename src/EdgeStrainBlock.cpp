@@ -0,0 +1,127 @@
+#include "EdgeStrainBlock.h"
+
+#include <cassert>
+
+namespace ShapeOp {
+
+namespace {
+
+// Edges per batch; fixed so the temporaries live on the stack and vectorize
+constexpr int kBatch = 64;
+typedef Eigen::Array<Scalar, kBatch, 1> BatchArray;
+
+} // namespace
+
+EdgeStrainBlock::EdgeStrainBlock(const Eigen::Matrix2Xi &edges,
+                                 Scalar weight,
+                                 const Matrix3X &positions,
+                                 Scalar rangeMin,
+                                 Scalar rangeMax)
+    : Constraint(std::vector<int>(), 1.0) {
+    const Eigen::Index m = edges.cols();
+    init(edges, VectorX::Constant(m, weight), positions, VectorX::Constant(m, rangeMin), VectorX::Constant(m, rangeMax));
+}
+
+EdgeStrainBlock::EdgeStrainBlock(const Eigen::Matrix2Xi &edges,
+                                 const VectorX &weights,
+                                 const Matrix3X &positions,
+                                 const VectorX &rangeMin,
+                                 const VectorX &rangeMax)
+    : Constraint(std::vector<int>(), 1.0) {
+    init(edges, weights, positions, rangeMin, rangeMax);
+}
+
+void EdgeStrainBlock::init(const Eigen::Matrix2Xi &edges, const VectorX &weights, const Matrix3X &positions,
+                           const VectorX &rangeMin, const VectorX &rangeMax) {
+    const int m = static_cast<int>(edges.cols());
+    assert(weights.size() == m && rangeMin.size() == m && rangeMax.size() == m);
+
+    i_.resize(m);
+    j_.resize(m);
+    rest_.resize(m);
+    weight_.resize(m);
+    rangeMin_ = rangeMin;
+    rangeMax_ = rangeMax;
+    for (int k = 0; k < m; ++k) {
+        i_[k] = edges(0, k);
+        j_[k] = edges(1, k);
+        // Same order of operations as EdgeStrainConstraint's constructor
+        Scalar length = (positions.col(j_[k]) - positions.col(i_[k])).norm();
+        rest_(k) = 1.0f / length;
+        weight_(k) = std::sqrt(weights(k));
+        weight_(k) *= std::sqrt(length);
+    }
+}
+
+void EdgeStrainBlock::project(const Matrix3X &positions, Matrix3X &projections) const {
+    projectRange(positions, projections, 0, nEdges());
+}
+
+void EdgeStrainBlock::projectRange(const Matrix3X &positions, Matrix3X &projections, int begin, int end) const {
+    const Scalar *p = positions.data();
+    Scalar *out = projections.data() + 3 * static_cast<Eigen::Index>(firstRow_);
+
+    BatchArray dx, dy, dz, rest, rmin, rmax, w;
+    for (int start = begin; start < end; start += kBatch) {
+        const int count = std::min(kBatch, end - start);
+
+        // Gather edge vectors into SoA batches
+        for (int k = 0; k < count; ++k) {
+            const Scalar *pi = p + 3 * static_cast<Eigen::Index>(i_[start + k]);
+            const Scalar *pj = p + 3 * static_cast<Eigen::Index>(j_[start + k]);
+            dx(k) = pj[0] - pi[0];
+            dy(k) = pj[1] - pi[1];
+            dz(k) = pj[2] - pi[2];
+        }
+
+        const int pad = kBatch - count;
+        if (pad > 0) {
+            // Tail batch: pad with a harmless unit edge
+            dx.tail(pad).setOnes();
+            dy.tail(pad).setZero();
+            dz.tail(pad).setZero();
+        }
+
+        // Vectorized projection: normalize, clamp the strain, scale by the weight
+        BatchArray l = (dx * dx + dy * dy + dz * dz).sqrt();
+        dx /= l;
+        dy /= l;
+        dz /= l;
+        BatchArray s;
+        if (pad == 0) {
+            s = Eigen::Map<const BatchArray>(weight_.data() + start) *
+                (l * Eigen::Map<const BatchArray>(rest_.data() + start))
+                    .max(Eigen::Map<const BatchArray>(rangeMin_.data() + start))
+                    .min(Eigen::Map<const BatchArray>(rangeMax_.data() + start));
+        } else {
+            rest.head(count) = rest_.segment(start, count);
+            rmin.head(count) = rangeMin_.segment(start, count);
+            rmax.head(count) = rangeMax_.segment(start, count);
+            w.head(count) = weight_.segment(start, count);
+            rest.tail(pad).setOnes();
+            rmin.tail(pad).setOnes();
+            rmax.tail(pad).setOnes();
+            w.tail(pad).setZero();
+            s = w * (l * rest).max(rmin).min(rmax);
+        }
+
+        // Scatter straight into the projection rows
+        Scalar *o = out + 3 * static_cast<Eigen::Index>(start);
+        for (int k = 0; k < count; ++k) {
+            o[3 * k + 0] = s(k) * dx(k);
+            o[3 * k + 1] = s(k) * dy(k);
+            o[3 * k + 2] = s(k) * dz(k);
+        }
+    }
+}
+
+void EdgeStrainBlock::addConstraint(std::vector<Triplet> &triplets, int &idO) const {
+    firstRow_ = idO;
+    for (int k = 0; k < nEdges(); ++k) {
+        triplets.push_back(Triplet(idO + k, i_[k], -weight_(k) * rest_(k)));
+        triplets.push_back(Triplet(idO + k, j_[k], weight_(k) * rest_(k)));
+    }
+    idO += nEdges();
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Constraint.h"
+#include "Types.h"
+#include <vector>
+
+namespace ShapeOp {
+
+// Many EdgeStrainConstraints packed into one constraint.
+// Edges are stored structure-of-arrays and projected in fixed-size batches with
+// Eigen packet math, writing straight into the projections matrix. Each edge gets
+// one projection row, in the order given, with exactly the arithmetic of an
+// individual EdgeStrainConstraint, so results match N separate constraints.
+class EdgeStrainBlock : public Constraint {
+public:
+    // edges: one column (i, j) per edge; weight and ranges as for EdgeStrainConstraint
+    EdgeStrainBlock(const Eigen::Matrix2Xi &edges,
+                    Scalar weight,
+                    const Matrix3X &positions,
+                    Scalar rangeMin = 1.0,
+                    Scalar rangeMax = 1.0);
+
+    // Per-edge weights and ranges (each of length edges.cols())
+    EdgeStrainBlock(const Eigen::Matrix2Xi &edges,
+                    const VectorX &weights,
+                    const Matrix3X &positions,
+                    const VectorX &rangeMin,
+                    const VectorX &rangeMax);
+
+    virtual void project(const Matrix3X &positions, Matrix3X &projections) const override;
+    virtual void addConstraint(std::vector<Triplet> &triplets, int &idO) const override;
+
+    // Projects edges [begin, end) only, so the block can be split across threads
+    void projectRange(const Matrix3X &positions, Matrix3X &projections, int begin, int end) const;
+
+    int nEdges() const { return static_cast<int>(i_.size()); }
+    Scalar rangeMin(int edge) const { return rangeMin_(edge); }
+    Scalar rangeMax(int edge) const { return rangeMax_(edge); }
+
+private:
+    void init(const Eigen::Matrix2Xi &edges, const VectorX &weights, const Matrix3X &positions,
+              const VectorX &rangeMin, const VectorX &rangeMax);
+
+    std::vector<int> i_;
+    std::vector<int> j_;
+    VectorX rest_;     // Inverse rest length
+    VectorX rangeMin_; // Minimum allowed length factor
+    VectorX rangeMax_; // Maximum allowed length factor
+    VectorX weight_;   // sqrt(weight * rest length), as EdgeStrainConstraint stores it
+    mutable int firstRow_ = 0;
+};
+
+} // namespace ShapeOp
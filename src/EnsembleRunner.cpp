@@ -0,0 +1,147 @@
+#include "EnsembleRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+namespace ShapeOp {
+
+static long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+EnsembleRunner::EnsembleRunner(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    workers_.reserve(threads);
+    for (int t = 0; t < threads; ++t) {
+        workers_.emplace_back(&EnsembleRunner::work, this);
+    }
+}
+
+EnsembleRunner::~EnsembleRunner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &w : workers_) {
+        w.join();
+    }
+}
+
+std::vector<EnsembleResult> EnsembleRunner::run(const std::vector<EnsembleProblem> &problems) {
+    std::vector<EnsembleResult> results(problems.size());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    problems_ = &problems;
+    results_ = &results;
+    next_ = 0;
+    completed_ = 0;
+    startNs_ = nowNs();
+    endNs_ = 0;
+    active_ = static_cast<int>(workers_.size());
+    ++generation_;
+    wake_.notify_all();
+
+    // Wait for every worker to leave the run, not just for the last problem, so
+    // none of them still holds on to problems or results when they go out of scope
+    done_.wait(lock, [this] { return active_ == 0; });
+    endNs_ = nowNs();
+    // Cleared only now, so a cancel() that came in before this run got going still applies
+    cancelled_ = false;
+    problems_ = nullptr;
+    results_ = nullptr;
+    return results;
+}
+
+void EnsembleRunner::cancel() {
+    cancelled_ = true;
+}
+
+std::size_t EnsembleRunner::completed() const {
+    return completed_;
+}
+
+double EnsembleRunner::problemsPerSecond() const {
+    const long long start = startNs_;
+    const long long end = endNs_ ? endNs_.load() : nowNs();
+    return end > start ? completed_ * 1e9 / (end - start) : 0.0;
+}
+
+void EnsembleRunner::work() {
+#ifdef SHAPEOP_OPENMP
+    // Parallelism comes from running problems side by side, not from inside a solver
+    omp_set_num_threads(1);
+#endif
+    // Per-thread allocator for constraint pools. Blocks freed with one problem's solver
+    // are reused by the next; the limit keeps whole constraint pools of nets up to
+    // about 100x100 in pooled blocks rather than going back to the heap.
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = 4 << 20;
+    std::pmr::unsynchronized_pool_resource resource(options);
+    unsigned long seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        const std::size_t count = problems_->size();
+        for (std::size_t i = next_++; i < count; i = next_++) {
+            if (!cancelled_) {
+                solveOne(i, resource);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
+
+void EnsembleRunner::solveOne(std::size_t index, std::pmr::unsynchronized_pool_resource &resource) {
+    const EnsembleProblem &problem = (*problems_)[index];
+    EnsembleResult &result = (*results_)[index];
+
+    try {
+        ExtendedSolver solver;
+        problem.build(solver, &resource);
+        solver.setTolerance(problem.criterion, problem.tolerance);
+        bool ok = solver.initialize(problem.dynamic, problem.masses, problem.damping, problem.timestep);
+        result.status = EnsembleResult::Status::Solved;
+        for (unsigned int s = 0; ok && s < problem.steps; ++s) {
+            if (cancelled_) {
+                result.status = EnsembleResult::Status::Cancelled;
+                break;
+            }
+            ok = solver.solve(problem.iterations);
+            result.iterations += solver.getIterations();
+            result.residual = solver.getResidual();
+        }
+        if (!ok) {
+            result.status = EnsembleResult::Status::Failed;
+        }
+        result.points = solver.getPoints();
+    } catch (const std::exception &) {
+        result.status = EnsembleResult::Status::Failed;
+    } catch (...) {
+        // Anything else a build callback throws must not escape the worker either
+        result.status = EnsembleResult::Status::Failed;
+    }
+
+    ++completed_;
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ExtendedSolver.h"
+#include "Types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ShapeOp {
+
+// One independent problem of an ensemble
+struct EnsembleProblem {
+    // Sets points and adds constraints and forces to a fresh solver. Constraint pools
+    // (ConstraintBuilder) should take their storage from the given resource: it is the
+    // worker thread's own, unsynchronized, and must not be used after the problem is done.
+    // A problem whose callback throws, whatever it throws, comes back Failed.
+    std::function<void(ExtendedSolver &solver, std::pmr::memory_resource *resource)> build;
+
+    bool dynamic = false;
+    Scalar masses = 1.0;
+    Scalar damping = 1.0;
+    Scalar timestep = 1.0;
+    unsigned int steps = 1;      // solve() calls
+    unsigned int iterations = 1; // Iterations per solve() call, an upper bound with a tolerance
+
+    ExtendedSolver::StopCriterion criterion = ExtendedSolver::StopCriterion::None;
+    Scalar tolerance = 0.0;
+};
+
+struct EnsembleResult {
+    enum class Status { Solved, Failed, Cancelled };
+
+    Status status = Status::Cancelled;
+    Matrix3X points;
+    unsigned int iterations = 0; // Summed over all solve() calls
+    Scalar residual = 0.0;       // Stopping criterion after the last solve() call
+};
+
+// Builds and solves many small independent problems on a fixed pool of threads,
+// one problem per thread at a time, which is what pays off for 10x10 to 50x50
+// nets where parallelizing inside a single solver does not.
+class EnsembleRunner {
+public:
+    // threads = 0 uses every hardware thread
+    explicit EnsembleRunner(int threads = 0);
+    ~EnsembleRunner();
+
+    EnsembleRunner(const EnsembleRunner &) = delete;
+    EnsembleRunner &operator=(const EnsembleRunner &) = delete;
+
+    // Solves all problems and returns their results in the same order. Blocks until
+    // every problem is solved, failed or cancelled.
+    std::vector<EnsembleResult> run(const std::vector<EnsembleProblem> &problems);
+
+    // Thread-safe, also from inside a build callback. Problems not yet started come back
+    // Cancelled; running ones stop after their current solve() call with the points so far.
+    // Applies to the run in progress, or to the next one if none is; run() clears it
+    // when it returns.
+    void cancel();
+
+    // Progress of the current (or last) run, safe to poll from any thread
+    std::size_t completed() const;
+    double problemsPerSecond() const;
+
+    int threads() const { return static_cast<int>(workers_.size()); }
+
+private:
+    void work();
+    void solveOne(std::size_t index, std::pmr::unsynchronized_pool_resource &resource);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_ = false;
+    unsigned long generation_ = 0; // Bumped once per run()
+    int active_ = 0;               // Workers still inside the current run
+
+    const std::vector<EnsembleProblem> *problems_ = nullptr;
+    std::vector<EnsembleResult> *results_ = nullptr;
+    std::atomic<std::size_t> next_{0};
+    std::atomic<std::size_t> completed_{0};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<long long> startNs_{0};
+    std::atomic<long long> endNs_{0};
+};
+
+} // namespace ShapeOp
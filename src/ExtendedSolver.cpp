@@ -0,0 +1,1347 @@
+#include "ExtendedSolver.h"
+#include "BatchForce.h"
+#include "Coarsening.h"
+#include "ConstraintBuilder.h"
+#include "ContactConstraint.h"
+#include "EdgeStrainBlock.h"
+#include "Trajectory.h"
+#include <Eigen/QR>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+namespace ShapeOp {
+
+namespace {
+
+// Index list for Eigen's indexed views, which copy a std::vector on every use
+Eigen::Map<const Eigen::VectorXi> indices(const std::vector<int> &ids) {
+    return Eigen::Map<const Eigen::VectorXi>(ids.data(), static_cast<Eigen::Index>(ids.size()));
+}
+
+} // namespace
+
+int ExtendedSolver::addConstraint(const std::shared_ptr<Constraint> &c) {
+    constraints_.push_back(c);
+    return static_cast<int>(constraints_.size()) - 1;
+}
+
+std::shared_ptr<Constraint> &ExtendedSolver::getConstraint(int id) {
+    return constraints_[id];
+}
+
+std::vector<int> ExtendedSolver::sortConstraints() {
+    // (type rank, smallest vertex) per constraint, the vertex read from its triplets
+    std::unordered_map<std::type_index, int> ranks;
+    std::vector<std::pair<int, int>> keys(constraints_.size());
+    std::vector<Triplet> triplets;
+    for (size_t c = 0; c < constraints_.size(); ++c) {
+        const auto rank = ranks.emplace(typeid(*constraints_[c]), static_cast<int>(ranks.size())).first->second;
+        triplets.clear();
+        int idO = 0;
+        constraints_[c]->addConstraint(triplets, idO);
+        int smallest = std::numeric_limits<int>::max();
+        for (const auto &t : triplets) {
+            smallest = std::min(smallest, t.col());
+        }
+        keys[c] = {rank, smallest};
+    }
+
+    std::vector<int> order(constraints_.size());
+    for (size_t c = 0; c < order.size(); ++c) {
+        order[c] = static_cast<int>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    std::vector<std::shared_ptr<Constraint>> sorted;
+    sorted.reserve(constraints_.size());
+    for (int c : order) {
+        sorted.push_back(std::move(constraints_[c]));
+    }
+    constraints_ = std::move(sorted);
+    return order;
+}
+
+int ExtendedSolver::addForces(const std::shared_ptr<Force> &f) {
+    forces_.push_back(f);
+    return static_cast<int>(forces_.size()) - 1;
+}
+
+std::shared_ptr<Force> &ExtendedSolver::getForce(int id) {
+    return forces_[id];
+}
+
+void ExtendedSolver::setPoints(const Matrix3X &p) {
+    p_ = p;
+}
+
+const Matrix3X &ExtendedSolver::getPoints() const {
+    return p_;
+}
+
+void ExtendedSolver::fixVertex(int id, const Vector3 &position) {
+    if (id < 0 || id >= p_.cols()) {
+        throw std::out_of_range("fixVertex: no vertex " + std::to_string(id));
+    }
+    if (static_cast<int>(fixedSlots_.size()) <= id) {
+        fixedSlots_.resize(p_.cols(), -1);
+    }
+    int &slot = fixedSlots_[id];
+    if (slot < 0) {
+        slot = static_cast<int>(fixedVertices_.size());
+        fixedVertices_.push_back(id);
+        fixedPositions_.conservativeResize(3, fixedVertices_.size());
+    }
+    fixedPositions_.col(slot) = position;
+    if (slot < static_cast<int>(systemFixed_.size())) {
+        p_.col(id) = position;
+    }
+}
+
+void ExtendedSolver::fixVertex(int id) {
+    if (id < 0 || id >= p_.cols()) {
+        throw std::out_of_range("fixVertex: no vertex " + std::to_string(id));
+    }
+    fixVertex(id, p_.col(id));
+}
+
+bool ExtendedSolver::isFixed(int id) const {
+    return id >= 0 && id < static_cast<int>(fixedSlots_.size()) && fixedSlots_[id] >= 0;
+}
+
+bool ExtendedSolver::initialize(bool dynamic, Scalar masses, Scalar damping, Scalar timestep) {
+    SHAPEOP_PHASE(initialize);
+    const int n = static_cast<int>(p_.cols());
+    assembleConstraints();
+
+    // Pinned vertices leave the unknowns; the global system is over the free ones
+    systemFixed_ = fixedVertices_;
+    freeVertices_.clear();
+    if (!systemFixed_.empty()) {
+        fixedSlots_.resize(n, -1);
+        std::vector<Eigen::Triplet<GlobalScalar>> select;
+        for (int v = 0; v < n; ++v) {
+            if (fixedSlots_[v] < 0) {
+                select.emplace_back(static_cast<int>(freeVertices_.size()), v, 1.0);
+                freeVertices_.push_back(v);
+            }
+        }
+        freeSelection_.resize(freeVertices_.size(), n);
+        freeSelection_.setFromTriplets(select.begin(), select.end());
+        select.clear();
+        for (size_t k = 0; k < systemFixed_.size(); ++k) {
+            select.emplace_back(static_cast<int>(k), systemFixed_[k], 1.0);
+            p_.col(systemFixed_[k]) = fixedPositions_.col(k);
+        }
+        fixedSelection_.resize(systemFixed_.size(), n);
+        fixedSelection_.setFromTriplets(select.begin(), select.end());
+    }
+
+    dynamic_ = dynamic;
+    masses_ = masses;
+    damping_ = damping;
+    delta_ = timestep;
+    if (dynamic_) {
+        velocities_.setZero(3, n);
+        momentum_.setZero(3, n);
+        oldPoints_.setZero(3, n);
+    }
+
+    forceMatrix_.setZero(3, n);
+    rhs_.setZero(n, 3);
+    x_.setZero(n, 3);
+    sizeAnderson();
+
+    coarse_.reset();
+    if (hierarchyLevels_ > 1 && !dynamic_ && !buildHierarchy()) {
+        return false;
+    }
+
+    // A warm start replaces the rest state only now, after the hierarchy took its
+    // coarse rest lengths from it
+    if (warmPoints_.cols() == n) {
+        p_ = warmPoints_;
+        for (size_t k = 0; k < systemFixed_.size(); ++k) {
+            p_.col(systemFixed_[k]) = fixedPositions_.col(k);
+        }
+    }
+    if (dynamic_ && warmVelocities_.cols() == n) {
+        velocities_ = warmVelocities_;
+    }
+    warmPoints_.resize(3, 0);
+    warmVelocities_.resize(3, 0);
+
+    if (iterative()) {
+        factorization_.reset();
+        return prepareIterative();
+    }
+    assembleSystem();
+    // Only a factorization of exactly this matrix will do: one of a neighbouring sweep
+    // step (another weight, timestep or pin set of the same size) solves the wrong system
+    if (factorization_ && factorization_->D.size() == N_.rows() && factorization_->matrix == matrixChecksum(N_)) {
+        ldlt_.setFactorization(*factorization_);
+        factorization_.reset();
+        return true;
+    }
+    factorization_.reset();
+    return factorizeSystem();
+}
+
+void ExtendedSolver::assembleConstraints() {
+    const int n = static_cast<int>(p_.cols());
+
+    // Assemble A from the constraints, one row per projection
+    triplets_.clear();
+    rowOffsets_.assign(1, 0);
+    tripletOffsets_.assign(1, 0);
+    int idO = 0;
+    for (const auto &c : constraints_) {
+        c->addConstraint(triplets_, idO);
+        rowOffsets_.push_back(idO);
+        tripletOffsets_.push_back(static_cast<int>(triplets_.size()));
+    }
+    projections_.setZero(3, idO);
+    partitionLocalStep();
+#ifdef SHAPEOP_INSTRUMENTATION
+    constraintTypes_.resize(constraints_.size());
+    for (size_t c = 0; c < constraints_.size(); ++c) {
+        constraintTypes_[c] = instrumentation_.constraintType(typeid(*constraints_[c]));
+    }
+    auto &perForce = instrumentation_.stats.perForce;
+    perForce.resize(forces_.size());
+    for (size_t k = 0; k < forces_.size(); ++k) {
+        perForce[k].name = Instrumentation::typeName(typeid(*forces_[k]));
+    }
+#endif
+
+    GlobalSparseMatrix A(idO, n);
+    A.setFromTriplets(triplets_.begin(), triplets_.end());
+    At_ = A.transpose();
+}
+
+bool ExtendedSolver::factorizeSystem() {
+    {
+        SHAPEOP_PHASE(analyze);
+        if (topologyCache_) {
+            topologyCache_->analyzePattern(N_, ldlt_);
+        } else {
+            ldlt_.analyzePattern(N_);
+        }
+    }
+    SHAPEOP_PHASE(factorize);
+    ldlt_.factorize(N_);
+    return ldlt_.info() == Eigen::Success;
+}
+
+bool ExtendedSolver::rebuildSystem() {
+    assembleConstraints();
+    if (iterative()) {
+        return prepareIterative();
+    }
+    assembleSystem();
+    return factorizeSystem();
+}
+
+std::shared_ptr<const LDLTFactorization> ExtendedSolver::getFactorization() const {
+    if (iterative()) {
+        return nullptr;
+    }
+    // N_ is the matrix last factorized; low-rank updates leave it as it was
+    auto f = ldlt_.factorization();
+    f->matrix = matrixChecksum(N_);
+    return f;
+}
+
+ExtendedSolver::WarmStart ExtendedSolver::getWarmStart() const {
+    WarmStart start;
+    start.points = p_;
+    if (dynamic_) {
+        start.velocities = velocities_;
+    }
+    start.factorization = getFactorization();
+    return start;
+}
+
+void ExtendedSolver::setWarmStart(const WarmStart &start) {
+    warmPoints_ = start.points;
+    warmVelocities_ = start.velocities;
+    factorization_ = start.factorization;
+}
+
+void ExtendedSolver::setGlobalSolver(GlobalSolver solver, Preconditioner preconditioner, Scalar tolerance,
+                                     int maxIterations) {
+    globalSolver_ = solver;
+    preconditioner_ = preconditioner;
+    cgTolerance_ = tolerance;
+    cgMaxIterations_ = maxIterations;
+}
+
+void ExtendedSolver::setHierarchy(int levels, int gridRows, int gridCols) {
+    hierarchyLevels_ = levels;
+    gridRows_ = gridRows;
+    gridCols_ = gridCols;
+}
+
+void ExtendedSolver::setCycle(int preSmoothing, int postSmoothing, int coarsestIterations) {
+    preSmoothing_ = preSmoothing;
+    postSmoothing_ = postSmoothing;
+    coarsestIterations_ = coarsestIterations;
+}
+
+bool ExtendedSolver::solve(unsigned int iteration) {
+    if (chebyshev_ && andersonWindow_ <= 0 && !coarse_ && iteration < chebyshevMinIterations) {
+        throw std::invalid_argument("solve: Chebyshev acceleration needs at least " +
+                                    std::to_string(chebyshevMinIterations) + " iterations per call");
+    }
+#ifdef SHAPEOP_INSTRUMENTATION
+    if (instrumentation_.enabled()) {
+        ++instrumentation_.stats.solves;
+    }
+#endif
+    if (dynamic_) {
+        computeForces();
+        oldPoints_ = p_;
+        momentum_ = p_ + damping_ * velocities_ * delta_ + forceMatrix_ * (delta_ * delta_ / masses_);
+        p_ = momentum_;
+    }
+
+    iterations_ = 0;
+    linearIterations_ = 0;
+    residual_ = 0.0;
+    andersonSize_ = 0;
+    andersonNext_ = 0;
+    andersonHasPrevious_ = false;
+    chebyshevStep_ = 0;
+    fallbacks_ = 0;
+    GlobalScalar reference = 0.0; // Previous energy, or the first gradient norm
+    GlobalScalar acceptedEnergy = 0.0;
+    bool anderson = andersonWindow_ > 0;
+    bool chebyshev = chebyshev_ && !anderson;
+    int consecutiveFallbacks = 0;
+    if (coarse_) {
+        for (unsigned int it = 0; it < iteration; ++it) {
+            ++iterations_;
+            if (criterion_ == StopCriterion::Energy || criterion_ == StopCriterion::Residual) {
+                projectConstraints();
+                buildRhs();
+                if (converged(it == 0, reference)) {
+                    break;
+                }
+            }
+            if (criterion_ == StopCriterion::Displacement) {
+                cycleStart_ = p_;
+            }
+            cycle();
+            if (recorder_) {
+                recorder_->record(p_);
+            }
+            if (criterion_ == StopCriterion::Displacement) {
+                residual_ = (p_ - cycleStart_).colwise().norm().maxCoeff();
+                if (residual_ <= tolerance_) {
+                    break;
+                }
+            }
+        }
+        return iterative() || ldlt_.info() == Eigen::Success;
+    }
+    for (unsigned int it = 0; it < iteration; ++it) {
+        ++iterations_;
+#ifdef SHAPEOP_INSTRUMENTATION
+        if (instrumentation_.enabled()) {
+            ++instrumentation_.stats.iterations;
+        }
+#endif
+
+        // Local step
+        projectConstraints();
+        buildRhs();
+
+        if (anderson || chebyshev) {
+            SHAPEOP_PHASE(acceleration);
+            // Safeguard: an accelerated point must not raise the energy; otherwise go
+            // back to the plain local/global result and restart acceleration from there
+            GlobalScalar energy = objective();
+            if (it > 0 && energy > acceptedEnergy) {
+                p_ = plainResult_.transpose().cast<Scalar>();
+                projectConstraints();
+                buildRhs();
+                energy = objective();
+                andersonSize_ = 0;
+                andersonNext_ = 0;
+                andersonHasPrevious_ = false;
+                chebyshevStep_ = 0;
+                if (chebyshev) {
+                    // Chebyshev overshot: under-relax from now on
+                    chebyshevRelaxation_ *= 0.9;
+                }
+                ++fallbacks_;
+                // Repeated fallbacks mean the objective is not monotone even for plain
+                // steps (position-dependent forces such as NormalForce): stop accelerating
+                if (++consecutiveFallbacks >= 3) {
+                    anderson = chebyshev = false;
+                }
+            } else {
+                consecutiveFallbacks = 0;
+            }
+            acceptedEnergy = energy;
+        }
+
+        // Energy and residual are tested at the current points, so a converged
+        // iteration skips its global step
+        if (criterion_ == StopCriterion::Energy || criterion_ == StopCriterion::Residual) {
+            if (converged(it == 0, reference)) {
+                break;
+            }
+        }
+
+        // Global step
+        solveSystem();
+        if (anderson) {
+            accelerate();
+        } else if (chebyshev) {
+            chebyshevStep();
+        }
+        if ((anderson || chebyshev) && !systemFixed_.empty()) {
+            pinRows();
+        }
+
+        if (criterion_ == StopCriterion::Displacement) {
+            SHAPEOP_PHASE(convergence);
+            residual_ = Scalar((x_ - p_.transpose().cast<GlobalScalar>()).rowwise().norm().maxCoeff());
+        }
+        p_ = x_.transpose().cast<Scalar>();
+        if (recorder_) {
+            recorder_->record(p_);
+        }
+        if (criterion_ == StopCriterion::Displacement && residual_ <= tolerance_) {
+            break;
+        }
+    }
+
+    if (chebyshev && chebyshevEstimate_ > 0.0) {
+        chebyshevEstimated_ = true;
+    }
+    if (dynamic_) {
+        velocities_ = (p_ - oldPoints_) / delta_;
+    }
+    return iterative() || ldlt_.info() == Eigen::Success;
+}
+
+void ExtendedSolver::globalStep() {
+    buildRhs();
+    solveSystem();
+    p_ = x_.transpose().cast<Scalar>();
+}
+
+void ExtendedSolver::buildRhs() {
+    SHAPEOP_PHASE(rhs);
+    // Casts are no-ops unless the global system is of higher precision than the points
+    rhs_.noalias() = At_ * projections_.transpose().cast<GlobalScalar>();
+    if (dynamic_) {
+        rhs_ += GlobalScalar(masses_ / (delta_ * delta_)) * momentum_.transpose().cast<GlobalScalar>();
+    } else if (!forces_.empty()) {
+        computeForces();
+        rhs_ += forceMatrix_.transpose().cast<GlobalScalar>();
+    }
+    if (!systemFixed_.empty() && !iterative()) {
+        // Pinned vertices move to the right-hand side: b_free - N_free,pinned p_pinned
+        const auto pinned = fixedPositions_.leftCols(systemFixed_.size()).transpose().cast<GlobalScalar>();
+        reducedRhs_ = rhs_(indices(freeVertices_), Eigen::all);
+        reducedRhs_.noalias() -= coupling_ * pinned;
+    }
+}
+
+GlobalScalar ExtendedSolver::objective() {
+    // Objective of the global step at the current points and projections:
+    //   E(p) = 1/2 |A p - P|^2 + m / (2 h^2) |p - momentum|^2   (dynamic)
+    //   E(p) = 1/2 |A p - P|^2 - f . p                          (static)
+    globalPoints_ = p_.transpose().cast<GlobalScalar>();
+    residualRows_.noalias() = At_.transpose() * globalPoints_;
+    residualRows_ -= projections_.transpose().cast<GlobalScalar>();
+    GlobalScalar energy = 0.5 * residualRows_.squaredNorm();
+    if (dynamic_) {
+        energy += 0.5 * masses_ / (delta_ * delta_) * (p_ - momentum_).cast<GlobalScalar>().squaredNorm();
+    } else if (!forces_.empty()) {
+        energy -= forceMatrix_.cast<GlobalScalar>().cwiseProduct(p_.cast<GlobalScalar>()).sum();
+    }
+    return energy;
+}
+
+bool ExtendedSolver::converged(bool first, GlobalScalar &reference) {
+    SHAPEOP_PHASE(convergence);
+    if (criterion_ == StopCriterion::Energy) {
+        const GlobalScalar energy = objective();
+        const GlobalScalar change = std::abs(reference - energy);
+        const GlobalScalar scale = std::max(std::abs(reference), std::abs(energy));
+        residual_ = first ? 1.0 : Scalar(scale > 0.0 ? change / scale : 0.0);
+        reference = energy;
+        return residual_ <= tolerance_;
+    }
+
+    // Gradient of E, N p - rhs, relative to its norm in the first iteration
+    if (iterative()) {
+        cgX_ = p_.cast<GlobalScalar>();
+        applySystem(cgX_, cgQ_);
+        cgQ_ -= rhs_.transpose();
+        maskPinned(cgQ_);
+        const GlobalScalar norm = cgQ_.norm();
+        if (first) {
+            reference = norm;
+        }
+        residual_ = Scalar(reference > 0.0 ? norm / reference : 0.0);
+        return residual_ <= tolerance_;
+    }
+    if (systemFixed_.empty()) {
+        freePoints_ = p_.transpose().cast<GlobalScalar>();
+    } else {
+        freePoints_ = p_(Eigen::all, indices(freeVertices_)).transpose().cast<GlobalScalar>();
+    }
+    gradient_.noalias() = N_ * freePoints_;
+    if (updateU_.cols() > 0) {
+        updateT_.resize(updateU_.cols(), 3);
+        for (int d = 0; d < 3; ++d) {
+            updateT_.col(d).noalias() = updateU_.transpose() * freePoints_.col(d);
+        }
+        updateT_ = updateSigns_.asDiagonal() * updateT_;
+        for (int d = 0; d < 3; ++d) {
+            gradient_.col(d).noalias() += updateU_ * updateT_.col(d);
+        }
+    }
+    gradient_ -= systemFixed_.empty() ? rhs_ : reducedRhs_;
+    const GlobalScalar norm = gradient_.norm();
+    if (first) {
+        reference = norm;
+    }
+    residual_ = Scalar(reference > 0.0 ? norm / reference : 0.0);
+    return residual_ <= tolerance_;
+}
+
+void ExtendedSolver::accelerate() {
+    // Anderson mixing of the fixed-point map G(p) = global(local(p)), with x_ = G(p_):
+    // the next iterate is G(p) - dG theta, where theta minimizes |f - dF theta| over the
+    // last differences of f = G(p) - p and of G
+    SHAPEOP_PHASE(acceleration);
+    const Eigen::Index size = x_.size();
+    const int window = andersonWindow_;
+    sizeAnderson();
+
+    andersonF0_ = x_ - p_.transpose().cast<GlobalScalar>();
+    const Eigen::Map<const GlobalVectorX> f(andersonF0_.data(), size);
+    if (andersonHasPrevious_) {
+        const int column = andersonNext_;
+        andersonF_.col(column) = f - Eigen::Map<const GlobalVectorX>(andersonPreviousF_.data(), size);
+        andersonDG_.col(column) = Eigen::Map<const GlobalVectorX>(x_.data(), size) -
+                                  Eigen::Map<const GlobalVectorX>(plainResult_.data(), size);
+        andersonNext_ = (andersonNext_ + 1) % window;
+        andersonSize_ = std::min(andersonSize_ + 1, window);
+    }
+    andersonPreviousF_ = andersonF0_;
+    plainResult_ = x_;
+    andersonHasPrevious_ = true;
+
+    if (andersonSize_ == 0) {
+        return;
+    }
+    // Column by column, so no product needs a workspace
+    const int m = andersonSize_;
+    andersonNormal_.resize(m, m);
+    andersonRhs_.resize(m);
+    for (int j = 0; j < m; ++j) {
+        for (int i = j; i < m; ++i) {
+            andersonNormal_(i, j) = andersonNormal_(j, i) = andersonF_.col(i).dot(andersonF_.col(j));
+        }
+        andersonRhs_(j) = andersonF_.col(j).dot(f);
+    }
+    andersonSolver_.compute(andersonNormal_);
+    andersonTheta_ = andersonSolver_.solve(andersonRhs_);
+    Eigen::Map<GlobalVectorX> x(x_.data(), size);
+    for (int j = 0; j < m; ++j) {
+        x -= andersonTheta_(j) * andersonDG_.col(j);
+    }
+}
+
+void ExtendedSolver::setAndersonWindow(int window) {
+    andersonWindow_ = std::min(window, static_cast<int>(AndersonMatrix::MaxColsAtCompileTime));
+    sizeAnderson();
+}
+
+void ExtendedSolver::sizeAnderson() {
+    const Eigen::Index size = x_.size();
+    if (andersonWindow_ <= 0 || (andersonF_.rows() == size && andersonF_.cols() == andersonWindow_)) {
+        return;
+    }
+    andersonF_.resize(size, andersonWindow_);
+    andersonDG_.resize(size, andersonWindow_);
+    andersonPreviousF_.resize(x_.rows(), 3);
+    andersonF0_.resize(x_.rows(), 3);
+    plainResult_.resize(x_.rows(), 3);
+}
+
+void ExtendedSolver::chebyshevStep() {
+    // Chebyshev semi-iteration (Wang 2015) on x_ = q^, with q^k = p_ and q^k-1 kept:
+    //   q^k+1 = omega (gamma (q^ - q^k) + q^k - q^k-1) + q^k-1
+    // after a few plain warm-up iterations. Without a given rho, the first solve() stays
+    // plain and estimates it from the ratio of its last successive displacements.
+    SHAPEOP_PHASE(acceleration);
+    plainResult_ = x_;
+    const int warmup = chebyshevWarmup;
+    const bool estimating = chebyshevRho_ <= 0.0 && !chebyshevEstimated_;
+    if (estimating || chebyshevStep_ < warmup) {
+        if (estimating) {
+            const Scalar displacement = Scalar((x_ - p_.transpose().cast<GlobalScalar>()).norm());
+            if (chebyshevStep_ > 0 && chebyshevDisplacement_ > 0.0) {
+                chebyshevEstimate_ = std::min(displacement / chebyshevDisplacement_, Scalar(0.999));
+            }
+            chebyshevDisplacement_ = displacement;
+        }
+        chebyshevOmega_ = 1.0;
+    } else {
+        const Scalar rho = getSpectralRadius();
+        chebyshevOmega_ = chebyshevStep_ == warmup ? 2.0 / (2.0 - rho * rho)
+                                                   : 4.0 / (4.0 - rho * rho * chebyshevOmega_);
+        const GlobalScalar omega = chebyshevOmega_, gamma = chebyshevGamma_;
+        const auto q = p_.transpose().cast<GlobalScalar>();
+        x_ = omega * (gamma * (x_ - q) + q - chebyshevPrevious_) + chebyshevPrevious_;
+    }
+    chebyshevPrevious_ = p_.transpose().cast<GlobalScalar>();
+    ++chebyshevStep_;
+}
+
+void ExtendedSolver::setChebyshev(bool enabled, Scalar rho, Scalar gamma) {
+    chebyshev_ = enabled;
+    chebyshevRho_ = rho;
+    chebyshevGamma_ = gamma;
+    chebyshevEstimate_ = 0.0;
+    chebyshevEstimated_ = false;
+    chebyshevRelaxation_ = 1.0;
+}
+
+void ExtendedSolver::setTolerance(StopCriterion criterion, Scalar tolerance) {
+    criterion_ = criterion;
+    tolerance_ = tolerance;
+}
+
+void ExtendedSolver::partitionLocalStep() {
+    partitionThreads_ = 1;
+#ifdef SHAPEOP_OPENMP
+    partitionThreads_ = omp_get_max_threads();
+#endif
+    // A few chunks per thread so dynamic scheduling can even out cost differences
+    const int chunks = partitionThreads_ > 1 ? 4 * partitionThreads_ : 1;
+    const int target = std::max(1, (rowOffsets_.back() + chunks - 1) / chunks);
+
+    tasks_.clear();
+    chunkOffsets_.assign(1, 0);
+    contactConstraints_.clear();
+    int filled = 0;
+    auto add = [&](const ProjectionTask &task, int rows) {
+        tasks_.push_back(task);
+        filled += rows;
+        if (filled >= target) {
+            chunkOffsets_.push_back(static_cast<int>(tasks_.size()));
+            filled = 0;
+        }
+    };
+
+    for (int c = 0; c < static_cast<int>(constraints_.size()); ++c) {
+        if (auto block = dynamic_cast<const EdgeStrainBlock *>(constraints_[c].get())) {
+            // Packed blocks are split so one large block still spreads over threads
+            for (int begin = 0; begin < block->nEdges();) {
+                const int end = std::min(block->nEdges(), begin + target - filled);
+                add({c, begin, end, block}, end - begin);
+                begin = end;
+            }
+        } else {
+            if (dynamic_cast<const ContactConstraint *>(constraints_[c].get())) {
+                contactConstraints_.push_back(c);
+            }
+            add({c, 0, 0, nullptr}, rowOffsets_[c + 1] - rowOffsets_[c]);
+        }
+    }
+    if (chunkOffsets_.back() != static_cast<int>(tasks_.size())) {
+        chunkOffsets_.push_back(static_cast<int>(tasks_.size()));
+    }
+}
+
+void ExtendedSolver::projectConstraints() {
+    SHAPEOP_PHASE(localStep);
+#ifdef SHAPEOP_OPENMP
+    if (omp_get_max_threads() != partitionThreads_) {
+        partitionLocalStep();
+    }
+#endif
+    // Contact detection parallelizes internally, so it runs ahead of the projections.
+    // Rows of vertices that came into or out of contact are switched in the matrix.
+    changedContacts_.clear();
+    for (int c : contactConstraints_) {
+        const auto contact = static_cast<const ContactConstraint *>(constraints_[c].get());
+        {
+            SHAPEOP_PHASE(collisions);
+            contact->detect(p_);
+        }
+        if (contact->contactsChanged()) {
+            changedContacts_.push_back(c);
+        }
+    }
+    if (!changedContacts_.empty()) {
+        updateConstraints(changedContacts_);
+    }
+    const int chunks = static_cast<int>(chunkOffsets_.size()) - 1;
+#ifdef SHAPEOP_INSTRUMENTATION
+    if (instrumentation_.enabled()) {
+        projectConstraintsInstrumented(chunks);
+        return;
+    }
+#endif
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int k = 0; k < chunks; ++k) {
+        for (int t = chunkOffsets_[k]; t < chunkOffsets_[k + 1]; ++t) {
+            const ProjectionTask &task = tasks_[t];
+            if (task.block) {
+                task.block->projectRange(p_, projections_, task.begin, task.end);
+            } else {
+                constraints_[task.constraint]->project(p_, projections_);
+            }
+        }
+    }
+}
+
+#ifdef SHAPEOP_INSTRUMENTATION
+void ExtendedSolver::projectConstraintsInstrumented(int chunks) {
+    // Same projections as projectConstraints(), timing each run of same-type tasks into
+    // the slot of its last task so threads never share a counter and the clock is read
+    // once per run rather than per constraint; the slots are summed per type afterwards
+    taskNs_.assign(tasks_.size(), 0);
+    chunkSpans_.resize(2 * chunks);
+    chunkThreads_.resize(chunks);
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int k = 0; k < chunks; ++k) {
+        std::int64_t start = instrumentation_.now();
+        chunkSpans_[2 * k] = start;
+        for (int t = chunkOffsets_[k]; t < chunkOffsets_[k + 1]; ++t) {
+            const ProjectionTask &task = tasks_[t];
+            if (task.block) {
+                task.block->projectRange(p_, projections_, task.begin, task.end);
+            } else {
+                constraints_[task.constraint]->project(p_, projections_);
+            }
+            if (t + 1 == chunkOffsets_[k + 1] ||
+                constraintTypes_[tasks_[t + 1].constraint] != constraintTypes_[task.constraint]) {
+                const std::int64_t end = instrumentation_.now();
+                taskNs_[t] = end - start;
+                start = end;
+            }
+        }
+        chunkSpans_[2 * k + 1] = start;
+#ifdef SHAPEOP_OPENMP
+        chunkThreads_[k] = omp_get_thread_num();
+#else
+        chunkThreads_[k] = 0;
+#endif
+    }
+
+    auto &types = instrumentation_.stats.constraintTypes;
+    for (size_t t = 0; t < tasks_.size(); ++t) {
+        const ProjectionTask &task = tasks_[t];
+        auto &type = types[constraintTypes_[task.constraint]];
+        type.projections += task.block ? task.end - task.begin : 1;
+        type.seconds += taskNs_[t] * 1e-9;
+    }
+    if (instrumentation_.tracing()) {
+        // Chunks go on their thread's row, below the phases on row 0
+        for (int k = 0; k < chunks; ++k) {
+            instrumentation_.trace("chunk", "localStep", chunkSpans_[2 * k], chunkSpans_[2 * k + 1],
+                                   chunkThreads_[k] + 1);
+        }
+    }
+}
+#endif
+
+void ExtendedSolver::assembleSystem() {
+    if (systemFixed_.empty()) {
+        N_ = At_ * At_.transpose();
+    } else {
+        const GlobalSparseMatrix AtFree = freeSelection_ * At_;
+        N_ = AtFree * AtFree.transpose();
+        coupling_ = AtFree * (fixedSelection_ * At_).transpose();
+    }
+    if (dynamic_) {
+        // Inertia term M / h^2 with lumped, uniform masses
+        GlobalSparseMatrix M(N_.rows(), N_.cols());
+        M.setIdentity();
+        N_ += M * GlobalScalar(masses_ / (delta_ * delta_));
+    }
+
+    updateU_.resize(N_.rows(), 0);
+    updateZ_.resize(N_.rows(), 0);
+    updateSigns_.resize(0);
+}
+
+bool ExtendedSolver::refactorize() {
+    assembleSystem();
+    SHAPEOP_PHASE(factorize);
+    ldlt_.factorize(N_);
+    return ldlt_.info() == Eigen::Success;
+}
+
+bool ExtendedSolver::updateConstraints(const std::vector<int> &ids) {
+    // Entries of A, merged per row and column, of the rows whose part in N changed. Kept
+    // sparse so that many changed rows cost nothing before the rank test below.
+    struct Change {
+        int col;
+        GlobalScalar before;
+        GlobalScalar after;
+    };
+    // A changed row's entries in changes, and whether its old and new free parts are
+    // nonzero: each nonzero side takes one column of U, so a row switched on or off by
+    // contact takes one
+    struct ChangedRow {
+        size_t begin;
+        size_t end;
+        bool before;
+        bool after;
+    };
+    std::vector<Triplet> rows;
+    std::vector<int> order;
+    std::vector<Change> entries, changes;
+    std::vector<ChangedRow> changedRows;
+    Eigen::Index addedRank = 0;
+    bool couplingChanged = false;
+    const auto pinned = [&](int v) {
+        return v < static_cast<int>(fixedSlots_.size()) && fixedSlots_[v] >= 0 &&
+               fixedSlots_[v] < static_cast<int>(systemFixed_.size());
+    };
+
+    for (int id : ids) {
+        rows.clear();
+        int idO = rowOffsets_[id];
+        constraints_[id]->addConstraint(rows, idO);
+
+        // The update paths assume the same rows and sparsity as at initialize()
+        const int first = tripletOffsets_[id];
+        bool sameStructure = idO == rowOffsets_[id + 1] && static_cast<int>(rows.size()) == tripletOffsets_[id + 1] - first;
+        for (size_t k = 0; sameStructure && k < rows.size(); ++k) {
+            sameStructure = rows[k].row() == triplets_[first + k].row() && rows[k].col() == triplets_[first + k].col();
+        }
+        if (!sameStructure) {
+            return rebuildSystem();
+        }
+
+        // Old and new entries of each row, written back into the triplets and A^T. Rows
+        // are taken in order of their triplets, which needn't be contiguous.
+        order.resize(rows.size());
+        for (size_t k = 0; k < rows.size(); ++k) {
+            order[k] = static_cast<int>(k);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return rows[a].row() < rows[b].row(); });
+        for (size_t begin = 0, end = 0; begin < order.size(); begin = end) {
+            const int r = rows[order[begin]].row();
+            entries.clear();
+            for (; end < order.size() && rows[order[end]].row() == r; ++end) {
+                const int k = order[end];
+                auto e = std::find_if(entries.begin(), entries.end(),
+                                      [&](const Change &c) { return c.col == rows[k].col(); });
+                if (e == entries.end()) {
+                    entries.push_back(Change{rows[k].col(), 0, 0});
+                    e = entries.end() - 1;
+                }
+                e->before += triplets_[first + k].value();
+                e->after += rows[k].value();
+                At_.coeffRef(rows[k].col(), r) = 0.0;
+            }
+            // Only the free part enters N; a change in a row on a pin changes the coupling
+            bool changed = false, onPin = false;
+            ChangedRow row{changes.size(), changes.size(), false, false};
+            bool freeChanged = false;
+            for (const Change &e : entries) {
+                const bool differs = e.before != e.after;
+                changed = changed || differs;
+                if (pinned(e.col)) {
+                    onPin = true;
+                } else {
+                    freeChanged = freeChanged || differs;
+                    row.before = row.before || e.before != 0.0;
+                    row.after = row.after || e.after != 0.0;
+                }
+            }
+            couplingChanged = couplingChanged || (changed && onPin);
+            if (freeChanged) {
+                changes.insert(changes.end(), entries.begin(), entries.end());
+                row.end = changes.size();
+                changedRows.push_back(row);
+                addedRank += row.before + row.after;
+            }
+        }
+        for (size_t k = 0; k < rows.size(); ++k) {
+            triplets_[first + k] = rows[k];
+            At_.coeffRef(rows[k].col(), rows[k].row()) += rows[k].value();
+        }
+    }
+    if (iterative()) {
+        return prepareIterative();
+    }
+
+    // Too many changed rows: numeric refactorization on the cached symbolic analysis
+    const Eigen::Index oldRank = updateU_.cols();
+    const Eigen::Index newRank = oldRank + addedRank;
+    if (newRank > maxUpdateRank_) {
+        return refactorize();
+    }
+    if (couplingChanged) {
+        coupling_ = (freeSelection_ * At_) * (fixedSelection_ * At_).transpose();
+    }
+    if (newRank == oldRank) {
+        return true;
+    }
+
+    // N' = N + sum(a' a'^T - a a^T): append a' and a to U and extend Z = N_^-1 U
+    const Eigen::Index unknowns = N_.rows();
+    updateU_.conservativeResize(unknowns, newRank);
+    updateU_.rightCols(newRank - oldRank).setZero();
+    updateSigns_.conservativeResize(newRank);
+    Eigen::Index column = oldRank;
+    for (const ChangedRow &row : changedRows) {
+        const Eigen::Index after = row.after ? column++ : -1;
+        const Eigen::Index before = row.before ? column++ : -1;
+        if (after >= 0) updateSigns_(after) = 1.0;
+        if (before >= 0) updateSigns_(before) = -1.0;
+        for (size_t k = row.begin; k < row.end; ++k) {
+            const Change &c = changes[k];
+            if (pinned(c.col)) {
+                continue;
+            }
+            // Unknown of the vertex: itself, or its place among the (ascending) free vertices
+            const Eigen::Index unknown =
+                systemFixed_.empty() ? c.col
+                                     : std::lower_bound(freeVertices_.begin(), freeVertices_.end(), c.col) -
+                                           freeVertices_.begin();
+            if (after >= 0) updateU_(unknown, after) = c.after;
+            if (before >= 0) updateU_(unknown, before) = c.before;
+        }
+    }
+    updateZ_.conservativeResize(unknowns, newRank);
+    updateZ_.rightCols(newRank - oldRank) = ldlt_.solve(updateU_.rightCols(newRank - oldRank));
+
+    GlobalMatrixXX C = updateU_.transpose() * updateZ_;
+    C.diagonal() += updateSigns_; // S^-1 = S for S = diag(+-1)
+    capacitance_.compute(C);
+    return ldlt_.info() == Eigen::Success;
+}
+
+void ExtendedSolver::solveSystem() {
+    SHAPEOP_PHASE(globalStep);
+    if (iterative()) {
+        solveIterative();
+        return;
+    }
+    const bool pinned = !systemFixed_.empty();
+    GlobalMatrixX3 &y = pinned ? freeSolution_ : x_;
+    ldlt_.solve(pinned ? reducedRhs_ : rhs_, y, solveWork_);
+    if (updateU_.cols() > 0) {
+        // Woodbury: (N + U S U^T)^-1 b = y - Z C^-1 U^T y with y = N^-1 b. One
+        // matrix-vector product per coordinate, which needs no blocking workspace.
+        updateT_.resize(updateU_.cols(), 3);
+        for (int d = 0; d < 3; ++d) {
+            updateT_.col(d).noalias() = updateU_.transpose() * y.col(d);
+        }
+        updateC_ = capacitance_.solve(updateT_);
+        for (int d = 0; d < 3; ++d) {
+            y.col(d).noalias() -= updateZ_ * updateC_.col(d);
+        }
+    }
+    if (pinned) {
+        x_(indices(freeVertices_), Eigen::all) = freeSolution_;
+        pinRows();
+    }
+}
+
+void ExtendedSolver::pinRows() {
+    x_(indices(systemFixed_), Eigen::all) =
+        fixedPositions_.leftCols(systemFixed_.size()).transpose().cast<GlobalScalar>();
+}
+
+bool ExtendedSolver::prepareIterative() {
+    AtRows_ = At_;
+    inertia_ = dynamic_ ? GlobalScalar(masses_ / (delta_ * delta_)) : GlobalScalar(0.0);
+    updateU_.resize(0, 0);
+    updateZ_.resize(0, 0);
+    updateSigns_.resize(0);
+
+    if (preconditioner_ == Preconditioner::IncompleteCholesky) {
+        GlobalSparseMatrix N = At_ * At_.transpose();
+        if (dynamic_) {
+            GlobalSparseMatrix M(N.rows(), N.cols());
+            M.setIdentity();
+            N += M * inertia_;
+        }
+        incompleteCholesky_.compute(N);
+        return incompleteCholesky_.info() == Eigen::Success;
+    }
+
+    // Jacobi: the diagonal of N, the squared norms of the rows of A^T plus the inertia
+    inverseDiagonal_.resize(AtRows_.rows());
+    for (Eigen::Index i = 0; i < AtRows_.rows(); ++i) {
+        GlobalScalar d = inertia_;
+        for (decltype(AtRows_)::InnerIterator it(AtRows_, i); it; ++it) {
+            d += it.value() * it.value();
+        }
+        inverseDiagonal_(i) = d > 0.0 ? 1.0 / d : 1.0;
+    }
+    return true;
+}
+
+void ExtendedSolver::applySystem(const GlobalMatrix3X &v, GlobalMatrix3X &out) {
+    // A v one constraint row (column of A^T) at a time, then A^T (A v) one vertex (row of
+    // A^T) at a time, so every output column is written by exactly one thread
+    const Eigen::Index rows = At_.cols(), n = At_.rows();
+    constraintRows_.resize(3, rows);
+    out.resize(3, n);
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (Eigen::Index j = 0; j < rows; ++j) {
+        Eigen::Matrix<GlobalScalar, 3, 1> sum = Eigen::Matrix<GlobalScalar, 3, 1>::Zero();
+        for (GlobalSparseMatrix::InnerIterator it(At_, j); it; ++it) {
+            sum += it.value() * v.col(it.index());
+        }
+        constraintRows_.col(j) = sum;
+    }
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (Eigen::Index i = 0; i < n; ++i) {
+        Eigen::Matrix<GlobalScalar, 3, 1> sum = inertia_ * v.col(i);
+        for (decltype(AtRows_)::InnerIterator it(AtRows_, i); it; ++it) {
+            sum += it.value() * constraintRows_.col(it.index());
+        }
+        out.col(i) = sum;
+    }
+}
+
+void ExtendedSolver::precondition() {
+    if (preconditioner_ == Preconditioner::IncompleteCholesky) {
+        cgZ_ = incompleteCholesky_.solve(cgR_.transpose()).transpose();
+    } else {
+        cgZ_ = cgR_ * inverseDiagonal_.asDiagonal();
+    }
+    maskPinned(cgZ_);
+}
+
+void ExtendedSolver::maskPinned(GlobalMatrix3X &v) const {
+    for (int id : systemFixed_) {
+        v.col(id).setZero();
+    }
+}
+
+void ExtendedSolver::solveIterative() {
+    // Preconditioned CG on the three coordinates at once, from the current points. Pinned
+    // vertices start at their positions and are masked out of the residual and the search
+    // directions, which is CG on the free vertices' system.
+    typedef Eigen::Array<GlobalScalar, 3, 1> Array3;
+    cgX_ = p_.cast<GlobalScalar>();
+    for (size_t k = 0; k < systemFixed_.size(); ++k) {
+        cgX_.col(systemFixed_[k]) = fixedPositions_.col(k).cast<GlobalScalar>();
+    }
+    cgR_ = rhs_.transpose();
+    maskPinned(cgR_);
+    const Array3 threshold = (cgTolerance_ * cgR_.rowwise().norm()).array().square();
+
+    applySystem(cgX_, cgQ_);
+    cgR_ -= cgQ_;
+    maskPinned(cgR_);
+    precondition();
+    cgD_ = cgZ_;
+    Array3 rz = cgR_.cwiseProduct(cgZ_).rowwise().sum().array();
+    int it = 0;
+    for (; it < cgMaxIterations_; ++it) {
+        if ((cgR_.rowwise().squaredNorm().array() <= threshold).all()) {
+            break;
+        }
+        applySystem(cgD_, cgQ_);
+        const Array3 dq = cgD_.cwiseProduct(cgQ_).rowwise().sum().array();
+        const Array3 alpha = (dq > 0.0).select(rz / dq, 0.0);
+        cgX_ += alpha.matrix().asDiagonal() * cgD_;
+        cgR_ -= alpha.matrix().asDiagonal() * cgQ_;
+        maskPinned(cgR_);
+        precondition();
+        const Array3 next = cgR_.cwiseProduct(cgZ_).rowwise().sum().array();
+        const Array3 beta = (rz > 0.0).select(next / rz, 0.0);
+        rz = next;
+        cgD_ = cgZ_ + beta.matrix().asDiagonal() * cgD_;
+    }
+    linearIterations_ += it;
+    x_ = cgX_.transpose();
+}
+
+bool ExtendedSolver::buildHierarchy() {
+    const int n = static_cast<int>(p_.cols());
+    Coarsening c;
+    if (gridRows_ > 0 && gridCols_ > 0 && gridRows_ * gridCols_ == n) {
+        c = coarsenGrid(gridRows_, gridCols_);
+    } else {
+        c = coarsenGraph(At_ * At_.transpose(), p_, systemFixed_);
+    }
+    const int m = static_cast<int>(c.seeds.size());
+    if (m < 16 || m > n * 0.8) {
+        return true; // Too small, or too poorly coarsened, to be worth a level
+    }
+
+    // Rows of A coupling two or more vertices become springs between their coarse
+    // vertices, keeping EdgeStrainBlock length ranges. An edge strain row has a^2 = w / L,
+    // so a uniform strain e costs a^2 L^2 e^2 / 2: that stiffness, summed over the rows
+    // between two groups and scaled up by all rows over crossing rows (rows within a group
+    // drop out), sets the coarse weight w = sum / L. One-vertex rows become closeness of
+    // their group's coarse vertex, weighted a^2.
+    const Eigen::Index rows = At_.cols();
+    VectorX rangeMin = VectorX::Ones(rows), rangeMax = VectorX::Ones(rows);
+    for (size_t k = 0; k < constraints_.size(); ++k) {
+        if (auto block = dynamic_cast<const EdgeStrainBlock *>(constraints_[k].get())) {
+            for (int edge = 0; edge < block->nEdges(); ++edge) {
+                rangeMin(rowOffsets_[k] + edge) = block->rangeMin(edge);
+                rangeMax(rowOffsets_[k] + edge) = block->rangeMax(edge);
+            }
+        }
+    }
+    struct Spring {
+        std::int64_t key; // u * m + v with u < v
+        GlobalScalar weight;
+        GlobalScalar rangeMin; // Weighted, divided by the weight once summed
+        GlobalScalar rangeMax;
+    };
+    std::vector<Spring> springs;
+    GlobalVectorX closeness = GlobalVectorX::Zero(m);
+    GlobalScalar total = 0.0, crossing = 0.0;
+    std::vector<std::pair<int, GlobalScalar>> row;
+    for (Eigen::Index j = 0; j < rows; ++j) {
+        row.clear();
+        for (GlobalSparseMatrix::InnerIterator it(At_, j); it; ++it) {
+            row.emplace_back(static_cast<int>(it.index()), it.value());
+        }
+        if (row.size() == 1) {
+            closeness(c.aggregate[row[0].first]) += row[0].second * row[0].second;
+            continue;
+        }
+        for (size_t a = 0; a < row.size(); ++a) {
+            for (size_t b = a + 1; b < row.size(); ++b) {
+                const GlobalScalar coefficient = std::max(std::abs(row[a].second), std::abs(row[b].second));
+                const GlobalScalar length = (p_.col(row[a].first) - p_.col(row[b].first)).norm();
+                const GlobalScalar weight = coefficient * coefficient * length * length;
+                total += weight;
+                int u = c.aggregate[row[a].first], v = c.aggregate[row[b].first];
+                if (u == v) {
+                    continue;
+                }
+                if (u > v) {
+                    std::swap(u, v);
+                }
+                springs.push_back({std::int64_t(u) * m + v, weight, weight * rangeMin(j), weight * rangeMax(j)});
+                crossing += weight;
+            }
+        }
+    }
+    std::sort(springs.begin(), springs.end(), [](const Spring &a, const Spring &b) { return a.key < b.key; });
+    std::vector<Spring> merged;
+    for (const Spring &spring : springs) {
+        if (merged.empty() || merged.back().key != spring.key) {
+            merged.push_back(spring);
+        } else {
+            merged.back().weight += spring.weight;
+            merged.back().rangeMin += spring.rangeMin;
+            merged.back().rangeMax += spring.rangeMax;
+        }
+    }
+    const GlobalScalar scale = crossing > 0.0 ? total / crossing : 1.0;
+    const Eigen::Index count = static_cast<Eigen::Index>(merged.size());
+    Eigen::Matrix2Xi edges(2, count);
+    VectorX weights(count), mins(count), maxs(count);
+    const Matrix3X coarsePoints = p_(Eigen::all, c.seeds);
+    for (Eigen::Index e = 0; e < count; ++e) {
+        const Spring &spring = merged[e];
+        edges.col(e) << int(spring.key / m), int(spring.key % m);
+        const GlobalScalar length = (coarsePoints.col(edges(0, e)) - coarsePoints.col(edges(1, e))).norm();
+        weights(e) = Scalar(length > 0.0 ? scale * spring.weight / length : 0.0);
+        mins(e) = spring.weight > 0.0 ? Scalar(spring.rangeMin / spring.weight) : Scalar(1.0);
+        maxs(e) = spring.weight > 0.0 ? Scalar(spring.rangeMax / spring.weight) : Scalar(1.0);
+    }
+
+    coarse_ = std::make_unique<ExtendedSolver>();
+    ExtendedSolver &coarse = *coarse_;
+    coarse.setPoints(coarsePoints);
+    ConstraintBuilder builder(coarse.getPoints());
+    coarse.addConstraint(builder.edgeStrainBlock(edges, weights, mins, maxs));
+    std::vector<int> held;
+    for (int k = 0; k < m; ++k) {
+        if (closeness(k) > 0.0) {
+            held.push_back(k);
+        }
+    }
+    std::vector<std::shared_ptr<Constraint>> closenessConstraints;
+    builder.closeness(Eigen::Map<const Eigen::VectorXi>(held.data(), held.size()),
+                      closeness(held).cast<Scalar>(), closenessConstraints);
+    addConstraints(coarse, closenessConstraints);
+    for (int k = 0; k < m; ++k) {
+        const int seed = c.seeds[k];
+        if (isFixed(seed) && fixedSlots_[seed] < static_cast<int>(systemFixed_.size())) {
+            coarse.fixVertex(k);
+        }
+    }
+    coarseForce_ = std::make_shared<FieldForce>();
+    coarseForce_->forces.setZero(3, m);
+    coarse.addForces(coarseForce_);
+    coarse.setHierarchy(hierarchyLevels_ - 1, c.rows, c.cols);
+    coarse.setCycle(preSmoothing_, postSmoothing_, coarsestIterations_);
+
+    coarseVertices_ = std::move(c.seeds);
+    GlobalVectorX free = GlobalVectorX::Ones(n);
+    free(systemFixed_).setZero();
+    prolongation_ = free.asDiagonal() * c.prolongation;
+    prolongation_.prune(GlobalScalar(0.0));
+    return coarse.initialize(false);
+}
+
+void ExtendedSolver::iterate(int iterations) {
+    for (int it = 0; it < iterations; ++it) {
+        projectConstraints();
+        buildRhs();
+        solveSystem();
+        p_ = x_.transpose().cast<Scalar>();
+    }
+}
+
+void ExtendedSolver::cycle() {
+    if (!coarse_) {
+        iterate(coarsestIterations_);
+        return;
+    }
+    iterate(preSmoothing_);
+
+    // Full approximation scheme: the coarse problem starts from the injected points y0,
+    // with the force b = P^T r - r_c(y0) (r = rhs - N p without b), so that y0 solves it
+    // exactly when this level is solved; its change from y0 is the correction
+    ExtendedSolver &coarse = *coarse_;
+    coarse.p_ = p_(Eigen::all, indices(coarseVertices_));
+    for (size_t k = 0; k < coarse.systemFixed_.size(); ++k) {
+        coarse.fixedPositions_.col(k) = coarse.p_.col(coarse.systemFixed_[k]);
+    }
+    residual(levelResidual_);
+    coarseForce_->forces.setZero();
+    coarse.residual(coarse.levelResidual_);
+    coarseResidual_.noalias() = prolongation_.transpose() * levelResidual_;
+    coarseResidual_ -= coarse.levelResidual_;
+    coarseForce_->forces = coarseResidual_.transpose().cast<Scalar>();
+    coarseStart_ = coarse.p_;
+    coarse.cycle();
+
+    // Step along the interpolated correction d that minimizes |A p - projections|^2 over
+    // the constraints active at p (off their projection): <r, d> / |A d|^2 on those rows.
+    // Slack ones don't resist d, and the full step overshoots on taut meshes.
+    coarseStart_ = coarse.p_ - coarseStart_;
+    correction_.noalias() = prolongation_ * coarseStart_.transpose().cast<GlobalScalar>();
+    activeRows_ = (residualRows_ - projections_.transpose().cast<GlobalScalar>()).rowwise().squaredNorm().array() >
+                  std::numeric_limits<Scalar>::epsilon() * residualRows_.rowwise().squaredNorm().array();
+    residualRows_.noalias() = At_.transpose() * correction_;
+    const GlobalScalar curvature = activeRows_.select(residualRows_.rowwise().squaredNorm().array(), 0.0).sum();
+    const GlobalScalar slope = levelResidual_.cwiseProduct(correction_).sum();
+    const GlobalScalar step = curvature > 0.0 ? std::max<GlobalScalar>(slope / curvature, 0.0) : 1.0;
+    p_ += (step * correction_).transpose().cast<Scalar>();
+
+    iterate(postSmoothing_);
+}
+
+void ExtendedSolver::residual(GlobalMatrixX3 &r) {
+    projectConstraints();
+    buildRhs();
+    globalPoints_ = p_.transpose().cast<GlobalScalar>();
+    residualRows_.noalias() = At_.transpose() * globalPoints_;
+    r = rhs_;
+    r.noalias() -= At_ * residualRows_;
+    r(indices(systemFixed_), Eigen::all).setZero();
+}
+
+void ExtendedSolver::computeForces() {
+    SHAPEOP_PHASE(forces);
+    forceMatrix_.setZero(3, p_.cols());
+#ifdef SHAPEOP_INSTRUMENTATION
+    if (instrumentation_.enabled()) {
+        computeForcesInstrumented();
+        return;
+    }
+#endif
+    if (batchedForces_) {
+        for (const auto &f : forces_) {
+            ShapeOp::addForces(*f, p_, forceMatrix_);
+        }
+    } else {
+        for (int i = 0; i < static_cast<int>(p_.cols()); ++i) {
+            for (const auto &f : forces_) {
+                forceMatrix_.col(i) += f->get(p_, i);
+            }
+        }
+    }
+}
+
+#ifdef SHAPEOP_INSTRUMENTATION
+void ExtendedSolver::computeForcesInstrumented() {
+    // One force at a time so each can be timed; every column still adds the forces up in
+    // the same order, so the result is the same as the vertex-major loop
+    auto &perForce = instrumentation_.stats.perForce;
+    perForce.resize(forces_.size());
+    for (size_t k = 0; k < forces_.size(); ++k) {
+        const Force &f = *forces_[k];
+        const std::int64_t start = instrumentation_.now();
+        if (batchedForces_) {
+            ShapeOp::addForces(f, p_, forceMatrix_);
+        } else {
+            for (int i = 0; i < static_cast<int>(p_.cols()); ++i) {
+                forceMatrix_.col(i) += f.get(p_, i);
+            }
+        }
+        perForce[k].seconds += (instrumentation_.now() - start) * 1e-9;
+        ++perForce[k].calls;
+    }
+}
+#endif
+
+void ExtendedSolver::setInstrumentation(bool enabled, bool trace) {
+#ifdef SHAPEOP_INSTRUMENTATION
+    instrumentation_.enable(enabled, trace);
+#else
+    (void)enabled;
+    (void)trace;
+#endif
+}
+
+SolverStats ExtendedSolver::getStats() const {
+#ifdef SHAPEOP_INSTRUMENTATION
+    return instrumentation_.stats;
+#else
+    return SolverStats();
+#endif
+}
+
+void ExtendedSolver::resetStats() {
+#ifdef SHAPEOP_INSTRUMENTATION
+    instrumentation_.reset();
+#endif
+}
+
+void ExtendedSolver::writeTrace(const std::string &filename) const {
+#ifdef SHAPEOP_INSTRUMENTATION
+    instrumentation_.writeTrace(filename);
+#else
+    Instrumentation().writeTrace(filename);
+#endif
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,404 @@
+#pragma once
+
+#include "Constraint.h"
+#include "Force.h"
+#include "Instrumentation.h"
+#include "Precision.h"
+#include "TopologyCache.h"
+#include "Types.h"
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/LU>
+#include <Eigen/QR>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ShapeOp {
+
+class ContactConstraint;
+class EdgeStrainBlock;
+class FieldForce;
+class TrajectoryRecorder;
+
+// Drop-in replacement for ShapeOp::Solver (same setup calls, same local/global
+// iteration) that owns its own global step so this repo can extend it.
+class ExtendedSolver {
+public:
+    // Early termination test for solve(), see setTolerance()
+    enum class StopCriterion {
+        None,         // Always run the requested iterations
+        Energy,       // Relative change of the local/global objective between iterations
+        Displacement, // Largest distance a point moved in the last global step
+        Residual      // Gradient of the objective |N p - rhs|, relative to the first iteration
+    };
+
+    // How the global step solves N x = rhs, see setGlobalSolver()
+    enum class GlobalSolver {
+        Direct,           // Sparse LDLT, factorized at initialize()
+        ConjugateGradient // Preconditioned CG, without forming a factorization
+    };
+    enum class Preconditioner {
+        Jacobi,            // Diagonal of N, fully matrix-free
+        IncompleteCholesky // Incomplete factorization of N, which is assembled for it
+    };
+
+    int addConstraint(const std::shared_ptr<Constraint> &c);
+    std::shared_ptr<Constraint> &getConstraint(int id);
+
+    // Optional pass before initialize(): regroups the constraints by type, in order of
+    // first appearance, and within a type by their smallest vertex, so the local step
+    // runs one project() override after another and walks points and projection rows
+    // forward. Pays off after renumbering the vertices (Reordering.h). Constraint ids
+    // change; returns the old id of each constraint in its new place.
+    std::vector<int> sortConstraints();
+    int addForces(const std::shared_ptr<Force> &f);
+    std::shared_ptr<Force> &getForce(int id);
+
+    void setPoints(const Matrix3X &p);
+    const Matrix3X &getPoints() const;
+
+    // Pins vertex id at position as a hard constraint: it leaves the unknowns of the
+    // global step and enters the right-hand side instead, rather than being held by a
+    // heavily weighted ClosenessConstraint. The factorized system gets smaller and better
+    // conditioned, and the pin cannot drift. New pins take effect at the next
+    // initialize(); moving a pinned vertex, by calling this again, takes effect at once
+    // and needs no refactorization. Throws std::out_of_range for an id outside the points.
+    void fixVertex(int id, const Vector3 &position);
+    void fixVertex(int id); // At its current point
+    bool isFixed(int id) const;
+
+    bool initialize(bool dynamic = false, Scalar masses = 1.0, Scalar damping = 1.0, Scalar timestep = 1.0);
+    bool solve(unsigned int iteration);
+
+    // Makes solve(iteration) stop as soon as the criterion falls to tolerance, with
+    // iteration as the upper bound. The objective is the one each global step minimizes,
+    // constraints plus the inertia (dynamic) or force (static) term, evaluated after the
+    // local step. Energy and Residual cost one sparse matrix-vector product per iteration,
+    // Displacement one pass over the points; all well below a global step.
+    void setTolerance(StopCriterion criterion, Scalar tolerance);
+    unsigned int getIterations() const { return iterations_; } // Iterations the last solve() ran
+    Scalar getResidual() const { return residual_; }           // Last value of the criterion
+
+    // Anderson acceleration of the local/global iteration over the last window iterates
+    // (0 disables, 5 to 10 is typical). An accelerated point that raises the objective is
+    // replaced by the plain local/global result, so the energy still never increases;
+    // after three such fallbacks in a row the rest of the solve() runs unaccelerated.
+    // History is kept within one solve() call; use it with solve(n) and a tolerance.
+    // Windows above 32 are clamped, so the mixing works in fixed storage.
+    void setAndersonWindow(int window);
+
+    // Chebyshev semi-iterative acceleration, meant for dynamic mode with a small fixed
+    // iteration budget per frame (ignored while Anderson is on). rho is the spectral radius
+    // of the plain iteration; 0 estimates it during the first solve(), which runs plain.
+    // gamma under-relaxes every step. Divergence is caught by the same safeguard as
+    // Anderson and also lowers the effective rho by 10% for all later steps.
+    // Each solve() starts over with chebyshevWarmup plain iterations, so only a budget
+    // above that accelerates anything: solve() throws std::invalid_argument for budgets
+    // below chebyshevMinIterations while the option is in effect. One solve(1) per frame,
+    // as in wind_cloth.cpp, needs plain iterations instead.
+    void setChebyshev(bool enabled, Scalar rho = 0.0, Scalar gamma = 0.9);
+    static constexpr unsigned int chebyshevWarmup = 3;
+    static constexpr unsigned int chebyshevMinIterations = chebyshevWarmup + 1;
+    Scalar getSpectralRadius() const {
+        return chebyshevRelaxation_ * (chebyshevRho_ > 0.0 ? chebyshevRho_ : chebyshevEstimate_);
+    }
+
+    // Safeguard fallbacks (Anderson or Chebyshev) in the last solve()
+    unsigned int getFallbacks() const { return fallbacks_; }
+
+    // Local step alone: projects every constraint for the current points, in parallel
+    // when built with SHAPEOP_OPENMP. solve() runs it once per iteration.
+    void projectConstraints();
+
+    // Global step alone: solves for new points from the current projections (and, in a
+    // static solve, the forces at the current points) and moves the points there.
+    // solve() runs it once per iteration, with acceleration on top if enabled.
+    void globalStep();
+
+    // Force evaluation alone: the summed forces at the current points. solve() runs it
+    // once per call when dynamic, once per iteration when static.
+    void computeForces();
+
+    // Evaluate each force with one batched call per iteration (default) or with the
+    // per-vertex get() loop ShapeOp::Solver uses.
+    void setBatchedForces(bool batched) { batchedForces_ = batched; }
+
+    // Incremental update after initialize(): call with the ids of constraints whose
+    // weights (or anything else feeding addConstraint) changed. Target-only changes such
+    // as ClosenessConstraint::setPosition are read by project() and need no update.
+    // Changed matrix rows are applied as a low-rank correction to the existing
+    // factorization, two columns per reweighted row and one per row switched on or off
+    // (rows on pinned vertices only need none), up to setMaxUpdateRank() columns; beyond
+    // that the matrix is refactorized numerically, reusing the symbolic analysis.
+    // Structural changes reassemble and refactorize the matrix; unlike initialize(), that
+    // keeps the points, velocities, pins and multigrid hierarchy as they are.
+    // ContactConstraint rows are switched this way as contacts come and go.
+    bool updateConstraints(const std::vector<int> &ids);
+    void setMaxUpdateRank(int rank) { maxUpdateRank_ = rank; }
+
+    // Share the ordering and symbolic factorization with other solvers of the same
+    // topology; initialize() then only factorizes numerically on a cache hit
+    void setTopologyCache(const std::shared_ptr<TopologyCache> &cache) { topologyCache_ = cache; }
+
+    // For meshes too large to factorize: with ConjugateGradient every global step runs
+    // preconditioned CG, warm-started from the current points, with N applied from the
+    // constraint rows (A^T A x plus the inertia term) rather than assembled, in parallel
+    // when built with SHAPEOP_OPENMP. tolerance bounds each coordinate's residual relative
+    // to its right-hand side; maxIterations caps one global step. Takes effect at the
+    // next initialize().
+    void setGlobalSolver(GlobalSolver solver, Preconditioner preconditioner = Preconditioner::Jacobi,
+                         Scalar tolerance = 1e-6, int maxIterations = 1000);
+    unsigned int getLinearIterations() const { return linearIterations_; } // CG iterations in the last solve()
+
+    // Hierarchical (multigrid) static solve for large nets and cloths, whose sag a plain
+    // local/global iteration needs thousands of iterations to carry in from the pins.
+    // initialize() builds up to levels - 1 coarser problems, each an ExtendedSolver of its
+    // own: by geometric coarsening if the points are a gridRows x gridCols grid numbered
+    // row-major (y * gridCols + x), otherwise by aggregation on the constraint graph. A
+    // coarse level has one edge strain per pair of neighbouring coarse vertices, carrying
+    // the fine strain weight between their groups at rest lengths from the current points,
+    // and the unary constraints' weight as closeness; pins carry over where a pinned vertex
+    // becomes a coarse vertex. solve(n) then runs up to n V-cycles of the full
+    // approximation scheme: preSmoothing local/global iterations, the coarse problem with
+    // a force that makes it consistent with this level's residual, its interpolated
+    // correction scaled by a line search, postSmoothing iterations; the coarsest level
+    // runs coarsestIterations. Defaults are 1, 1 and 5: solving the nonlinear coarse
+    // problem much further than that fights the smoothing. The stop criterion is tested
+    // once per cycle, getIterations() counts cycles, and Anderson and Chebyshev are not
+    // applied. Dynamic solves ignore it; levels <= 1 turns it off. Takes effect at the
+    // next initialize().
+    void setHierarchy(int levels, int gridRows = 0, int gridCols = 0);
+    void setCycle(int preSmoothing, int postSmoothing, int coarsestIterations);
+    int getLevels() const { return coarse_ ? coarse_->getLevels() + 1 : 1; } // Built by initialize()
+
+    // Factorization of the global matrix from the last initialize() or refactorization,
+    // without pending low-rank updates; null with the ConjugateGradient global solver
+    std::shared_ptr<const LDLTFactorization> getFactorization() const;
+
+    // Hand the next initialize() a factorization of the matrix it will assemble, such as
+    // one saved with a scene; it then skips analysis and factorization altogether. Used
+    // once, and only if it factorizes exactly that matrix (LDLTFactorization::matrix):
+    // after any change to constraints, weights, pins or settings that reaches the matrix,
+    // initialize() factorizes as usual.
+    void setFactorization(const std::shared_ptr<const LDLTFactorization> &factorization) {
+        factorization_ = factorization;
+    }
+
+    // What a finished solve hands to the next initialize() of a related problem, such as
+    // the same net with its corners lifted a little higher, so that it starts near its
+    // solution: the points, the velocities of a dynamic solve, and the factorization.
+    // Projections need no carrying over, the first local step recomputes them.
+    struct WarmStart {
+        Matrix3X points;
+        Matrix3X velocities; // Empty for a static solve
+        std::shared_ptr<const LDLTFactorization> factorization; // Null with ConjugateGradient
+    };
+    WarmStart getWarmStart() const;
+
+    // Makes the next initialize() start from start.points (pins still go to their
+    // positions) rather than the rest state the constraints were built from, and hands
+    // it start.factorization as setFactorization() does, which is only used if the
+    // matrix is still the same. Used once; points and velocities whose size doesn't
+    // match are ignored.
+    void setWarmStart(const WarmStart &start);
+
+    // Record the points after every iteration of solve(); null stops recording
+    void setRecorder(const std::shared_ptr<TrajectoryRecorder> &recorder) { recorder_ = recorder; }
+
+    // Per-phase timing, projection counts and time per constraint type, time per force
+    // and iteration counts (see SolverStats), optionally with a Chrome trace of every
+    // phase. Off by default, and only available in builds with the CMake option
+    // SHAPEOP_INSTRUMENTATION: without it these do nothing, getStats() stays empty and
+    // writeTrace() writes an empty trace. Enabling starts from zero.
+    void setInstrumentation(bool enabled, bool trace = false);
+    SolverStats getStats() const;
+    void resetStats();
+    void writeTrace(const std::string &filename) const;
+
+private:
+    // One unit of local step work: a whole constraint, or edges [begin, end) of a packed block
+    struct ProjectionTask {
+        int constraint;
+        int begin;
+        int end;
+        const EdgeStrainBlock *block;
+    };
+
+    void partitionLocalStep();
+    void assembleConstraints(); // A^T, row offsets and local step tasks from the constraints
+    bool factorizeSystem();     // Symbolic and numeric factorization of N_
+    bool rebuildSystem();       // Both, and N_, for a structural change after initialize()
+    void solveSystem(); // x_ = N^-1 rhs_, including pending low-rank corrections
+    void assembleSystem(); // N_ from At_ and the inertia term
+    bool refactorize();
+    void buildRhs();
+    GlobalScalar objective(); // Objective of the global step at p_, after the local step
+    bool converged(bool first, GlobalScalar &reference); // Energy and Residual tests
+    void accelerate();  // Anderson update of x_
+    void sizeAnderson(); // History and least-squares workspaces for the window
+    void chebyshevStep(); // Chebyshev update of x_
+    void pinRows();       // Pinned vertices' rows of x_ to their positions
+    bool iterative() const { return globalSolver_ == GlobalSolver::ConjugateGradient; }
+    bool prepareIterative(); // Row-major A^T and the preconditioner, instead of factorizing
+    void applySystem(const GlobalMatrix3X &v, GlobalMatrix3X &out); // out = N v, matrix-free
+    void precondition(); // cgZ_ from cgR_
+    void maskPinned(GlobalMatrix3X &v) const;
+    void solveIterative(); // x_ = N^-1 rhs_ by preconditioned CG
+    bool buildHierarchy(); // coarse_ and how it maps to this level
+    void iterate(int iterations); // Plain local/global iterations
+    void cycle(); // One V-cycle from this level down
+    void residual(GlobalMatrixX3 &r); // rhs - N p after a local step, zero at pins
+#ifdef SHAPEOP_INSTRUMENTATION
+    void projectConstraintsInstrumented(int chunks);
+    void computeForcesInstrumented();
+#endif
+
+    std::vector<std::shared_ptr<Constraint>> constraints_;
+    std::vector<std::shared_ptr<Force>> forces_;
+
+    Matrix3X p_;
+    Matrix3X projections_;
+    Matrix3X forceMatrix_; // Accumulated forces, one column per point
+    GlobalMatrixX3 rhs_;          // Global step right-hand side
+    GlobalMatrixX3 x_;            // Global step solution
+    GlobalMatrixX3 residualRows_; // A p - projections, for the energy test
+    GlobalMatrixX3 globalPoints_; // p in the global precision, for sparse products
+    GlobalMatrixX3 gradient_;     // N p - rhs, for the residual test
+
+    std::vector<Triplet> triplets_;   // Rows of A as produced by the constraints
+    std::vector<int> rowOffsets_;     // First row of A per constraint
+    std::vector<int> tripletOffsets_; // First triplet per constraint
+
+    // Local step chunks of roughly equal projection rows; constraints write disjoint
+    // rows, so any split gives the serial result bit for bit
+    std::vector<ProjectionTask> tasks_;
+    std::vector<int> chunkOffsets_; // First task per chunk
+    int partitionThreads_ = 1;      // Thread count the chunks were sized for
+    std::vector<int> contactConstraints_; // Detected before each local step
+    std::vector<int> changedContacts_;    // Those whose contacts changed, for updateConstraints()
+
+    GlobalSparseMatrix At_;
+    GlobalSparseMatrix N_;
+    SymbolicLDLT ldlt_;
+
+    // Pinned vertices in the order pinned, with their positions and each vertex's index
+    // among them (-1 if free). initialize() takes the global system over the free
+    // vertices only, with the coupling N_free,pinned moving pins to the right-hand side.
+    std::vector<int> fixedVertices_;
+    Matrix3X fixedPositions_;
+    std::vector<int> fixedSlots_;
+    std::vector<int> systemFixed_; // Pins the system was built with, a prefix of fixedVertices_
+    std::vector<int> freeVertices_; // Unknown of the global system per row, when pinned
+    GlobalSparseMatrix freeSelection_;  // Rows of the identity for the free vertices
+    GlobalSparseMatrix fixedSelection_; // and for the pinned ones
+    GlobalSparseMatrix coupling_;
+    GlobalMatrixX3 reducedRhs_;    // Right-hand side over the free vertices
+    GlobalMatrixX3 freeSolution_;  // Solution over the free vertices
+    GlobalMatrixX3 freePoints_;    // Free vertices' points, for the residual test
+    GlobalMatrixX3 solveWork_;     // Permuted right-hand side of the factorized solve
+
+    // Conjugate gradient global step. A^T by rows gives each thread its own outputs when
+    // applying A^T; A itself is read by the columns of At_.
+    GlobalSolver globalSolver_ = GlobalSolver::Direct;
+    Preconditioner preconditioner_ = Preconditioner::Jacobi;
+    Scalar cgTolerance_ = 1e-6;
+    int cgMaxIterations_ = 1000;
+    unsigned int linearIterations_ = 0;
+    Eigen::SparseMatrix<GlobalScalar, Eigen::RowMajor> AtRows_;
+    GlobalScalar inertia_ = 0.0; // m / h^2 when dynamic
+    GlobalVectorX inverseDiagonal_;
+    Eigen::IncompleteCholesky<GlobalScalar> incompleteCholesky_;
+    GlobalMatrix3X constraintRows_; // A v
+    GlobalMatrix3X cgX_, cgR_, cgZ_, cgD_, cgQ_;
+
+    // Hierarchy: the next coarser level takes its points from coarseVertices_ and hands
+    // back corrections through prolongation_, whose rows are zero at pins
+    int hierarchyLevels_ = 1;
+    int gridRows_ = 0;
+    int gridCols_ = 0;
+    int preSmoothing_ = 1;
+    int postSmoothing_ = 1;
+    int coarsestIterations_ = 5;
+    std::unique_ptr<ExtendedSolver> coarse_;
+    std::vector<int> coarseVertices_;
+    GlobalSparseMatrix prolongation_;
+    std::shared_ptr<FieldForce> coarseForce_; // The coarse problem's consistency force
+    GlobalMatrixX3 levelResidual_;
+    GlobalMatrixX3 correction_; // Interpolated coarse correction
+    GlobalMatrixX3 coarseResidual_; // Restricted residual
+    Eigen::Array<bool, Eigen::Dynamic, 1> activeRows_; // Constraint rows off their projection
+    Matrix3X coarseStart_; // Coarse points before its cycle, then their change
+    Matrix3X cycleStart_;  // Points before a cycle, for the Displacement test
+    std::shared_ptr<TopologyCache> topologyCache_;
+    std::shared_ptr<const LDLTFactorization> factorization_;
+    Matrix3X warmPoints_;     // From setWarmStart(), for the next initialize()
+    Matrix3X warmVelocities_;
+    std::shared_ptr<TrajectoryRecorder> recorder_;
+
+#ifdef SHAPEOP_INSTRUMENTATION
+    Instrumentation instrumentation_;
+    std::vector<int> constraintTypes_;     // Index into stats.constraintTypes per constraint
+    std::vector<std::int64_t> taskNs_;     // Local step time per task, summed per type afterwards
+    std::vector<std::int64_t> chunkSpans_; // Start and end of each local step chunk, for the trace
+    std::vector<int> chunkThreads_;
+#endif
+
+    // Woodbury correction N = N_ + U S U^T on top of the factorization of N_,
+    // with S = diag(updateSigns_), Z = N_^-1 U and capacitance C = S^-1 + U^T Z
+    GlobalMatrixXX updateU_;
+    GlobalMatrixXX updateZ_;
+    GlobalVectorX updateSigns_;
+    Eigen::PartialPivLU<GlobalMatrixXX> capacitance_;
+    GlobalMatrixX3 updateT_; // U^T y
+    GlobalMatrixX3 updateC_; // C^-1 U^T y
+    int maxUpdateRank_ = 16;
+
+    // Anderson history: differences of f = G(p) - p and of G(p), as flattened columns
+    int andersonWindow_ = 0;
+    int andersonSize_ = 0;
+    int andersonNext_ = 0;
+    bool andersonHasPrevious_ = false;
+    GlobalMatrixXX andersonF_;
+    GlobalMatrixXX andersonDG_;
+    GlobalMatrixX3 andersonPreviousF_;
+    GlobalMatrixX3 andersonF0_; // f of the current iteration
+    // Least-squares system for the mixing weights, dF^T dF theta = dF^T f, with storage
+    // inline up to the largest window so that solving it never allocates
+    typedef Eigen::Matrix<GlobalScalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, 32, 32> AndersonMatrix;
+    typedef Eigen::Matrix<GlobalScalar, Eigen::Dynamic, 1, Eigen::ColMajor, 32, 1> AndersonVector;
+    AndersonMatrix andersonNormal_;
+    AndersonVector andersonRhs_;
+    AndersonVector andersonTheta_;
+    Eigen::CompleteOrthogonalDecomposition<AndersonMatrix> andersonSolver_;
+
+    // Chebyshev state; the estimate and relaxation carry over between solve() calls
+    bool chebyshev_ = false;
+    Scalar chebyshevRho_ = 0.0;
+    Scalar chebyshevGamma_ = 0.9;
+    Scalar chebyshevEstimate_ = 0.0;
+    bool chebyshevEstimated_ = false;
+    Scalar chebyshevRelaxation_ = 1.0;
+    Scalar chebyshevOmega_ = 1.0;
+    Scalar chebyshevDisplacement_ = 0.0;
+    int chebyshevStep_ = 0;
+    GlobalMatrixX3 chebyshevPrevious_;
+
+    GlobalMatrixX3 plainResult_; // Last plain local/global result, for the safeguard
+    unsigned int fallbacks_ = 0;
+
+    StopCriterion criterion_ = StopCriterion::None;
+    Scalar tolerance_ = 0.0;
+    unsigned int iterations_ = 0;
+    Scalar residual_ = 0.0;
+
+    bool dynamic_ = false;
+    bool batchedForces_ = true;
+    Scalar masses_ = 1.0;
+    Scalar damping_ = 1.0;
+    Scalar delta_ = 1.0;
+    Matrix3X velocities_;
+    Matrix3X momentum_;
+    Matrix3X oldPoints_;
+};
+
+} // namespace ShapeOp
@@ -0,0 +1,89 @@
+#pragma once
+
+// Thin POSIX file wrappers shared by the mesh and trajectory readers and writers.
+// Both throw std::runtime_error on failure.
+
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ShapeOp {
+
+// Read-only memory mapping of a whole file, advised for a front-to-back read or random access
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &filename, bool sequential = true) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open " + filename);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat " + filename);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to map " + filename);
+            }
+            ::madvise(data, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            data_ = static_cast<const char *>(data);
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Write-only file that takes whole buffers, each normally in a single write()
+class OutputFile {
+public:
+    explicit OutputFile(const std::string &filename) : filename_(filename) {
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open file for writing: " + filename);
+        }
+    }
+    ~OutputFile() { ::close(fd_); }
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    void write(const char *data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                throw std::runtime_error("Failed to write " + filename_);
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+    void write(const std::string &text) { write(text.data(), text.size()); }
+
+private:
+    std::string filename_;
+    int fd_;
+};
+
+} // namespace ShapeOp
@@ -0,0 +1,87 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#ifdef __GNUG__
+#include <cstdlib>
+#include <cxxabi.h>
+#endif
+
+namespace ShapeOp {
+
+void Instrumentation::enable(bool enabled, bool trace) {
+    if (enabled && !enabled_) {
+        reset();
+    }
+    enabled_ = enabled;
+    trace_ = enabled && trace;
+}
+
+void Instrumentation::reset() {
+    // Keep the constraint types: the solver refers to them by index
+    std::vector<SolverStats::ConstraintType> types = std::move(stats.constraintTypes);
+    for (auto &type : types) {
+        type.projections = 0;
+        type.seconds = 0.0;
+    }
+    std::vector<SolverStats::ForceStats> forces = std::move(stats.perForce);
+    for (auto &force : forces) {
+        force.calls = 0;
+        force.seconds = 0.0;
+    }
+    stats = SolverStats();
+    stats.constraintTypes = std::move(types);
+    stats.perForce = std::move(forces);
+    events_.clear();
+    epoch_ = Clock::now();
+}
+
+void Instrumentation::trace(const char *name, const char *category, std::int64_t startNs, std::int64_t endNs,
+                            int thread) {
+    events_.push_back({name, category, startNs, endNs, thread});
+}
+
+std::string Instrumentation::typeName(const std::type_info &type) {
+#ifdef __GNUG__
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    if (status == 0 && demangled) {
+        std::string name(demangled);
+        std::free(demangled);
+        return name;
+    }
+#endif
+    return type.name();
+}
+
+int Instrumentation::constraintType(const std::type_info &type) {
+    for (size_t k = 0; k < types_.size(); ++k) {
+        if (*types_[k] == type) return static_cast<int>(k);
+    }
+    types_.push_back(&type);
+    stats.constraintTypes.push_back({typeName(type)});
+    return static_cast<int>(types_.size()) - 1;
+}
+
+void Instrumentation::writeTrace(const std::string &filename) const {
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open file for writing: " + filename);
+    }
+    // Complete ("X") events, timestamps and durations in microseconds
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\": [\n";
+    for (size_t k = 0; k < events_.size(); ++k) {
+        const Event &e = events_[k];
+        file << "  {\"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"ts\": "
+             << e.startNs / 1e3 << ", \"dur\": " << (e.endNs - e.startNs) / 1e3 << ", \"pid\": 0, \"tid\": "
+             << e.thread << "}" << (k + 1 < events_.size() ? "," : "") << "\n";
+    }
+    file << "], \"displayTimeUnit\": \"ms\"}\n";
+    if (!file) {
+        throw std::runtime_error("Failed to write " + filename);
+    }
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace ShapeOp {
+
+struct PhaseStats {
+    double seconds = 0.0;
+    unsigned long calls = 0;
+};
+
+// What ExtendedSolver spent its time on since instrumentation was enabled or reset.
+// Wall-clock seconds; phases nest (initialize contains analyze and factorize, an
+// iteration contains the others), and with OpenMP the local step is wall time while the
+// per-constraint-type seconds add up the time of every thread.
+struct SolverStats {
+    PhaseStats initialize;   // Whole initialize()
+    PhaseStats analyze;      // Symbolic analysis, or the topology cache lookup
+    PhaseStats factorize;    // Numeric factorization
+    PhaseStats localStep;    // Constraint projection
+    PhaseStats collisions;   // Contact detection, part of the local step
+    PhaseStats rhs;          // Global step right-hand side (static solves evaluate forces in it)
+    PhaseStats forces;       // Force evaluation
+    PhaseStats globalStep;   // Back-substitution, including low-rank corrections
+    PhaseStats acceleration; // Anderson or Chebyshev update and the safeguard, which may
+                             // re-run the local step
+    PhaseStats convergence;  // Stopping tests
+
+    struct ConstraintType {
+        std::string name;
+        unsigned long projections = 0; // Edges, for a packed EdgeStrainBlock
+        double seconds = 0.0;
+    };
+    std::vector<ConstraintType> constraintTypes;
+
+    struct ForceStats {
+        std::string name;
+        unsigned long calls = 0;
+        double seconds = 0.0;
+    };
+    std::vector<ForceStats> perForce; // Indexed like the solver's forces
+
+    unsigned long solves = 0;
+    unsigned long iterations = 0;
+};
+
+// Collects SolverStats and, optionally, Chrome trace events (chrome://tracing or
+// Perfetto). Built only with the CMake option SHAPEOP_INSTRUMENTATION; without it
+// ExtendedSolver carries none of this and the SHAPEOP_PHASE scopes vanish. With it but
+// disabled at run time, each scope costs one branch.
+class Instrumentation {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void enable(bool enabled, bool trace);
+    bool enabled() const { return enabled_; }
+    bool tracing() const { return trace_; }
+    void reset();
+
+    // Nanoseconds since enable() or reset(), the trace's time base
+    std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count();
+    }
+
+    // Adds a completed span; thread is the trace row it shows up on
+    void trace(const char *name, const char *category, std::int64_t startNs, std::int64_t endNs, int thread = 0);
+
+    // Index of the constraint type in stats.constraintTypes, added on first sight
+    int constraintType(const std::type_info &type);
+
+    // Readable (demangled where possible) name of a type
+    static std::string typeName(const std::type_info &type);
+
+    // Writes the trace events as Chrome trace-event JSON; throws std::runtime_error on failure
+    void writeTrace(const std::string &filename) const;
+
+    SolverStats stats;
+
+    // Times a scope into a phase and, when tracing, emits it as a trace event
+    class Scope {
+    public:
+        Scope(Instrumentation &instrumentation, PhaseStats &phase, const char *name)
+            : instrumentation_(instrumentation.enabled_ ? &instrumentation : nullptr), phase_(phase), name_(name) {
+            if (instrumentation_) startNs_ = instrumentation_->now();
+        }
+        ~Scope() {
+            if (!instrumentation_) return;
+            const std::int64_t endNs = instrumentation_->now();
+            phase_.seconds += (endNs - startNs_) * 1e-9;
+            ++phase_.calls;
+            if (instrumentation_->trace_) instrumentation_->trace(name_, "phase", startNs_, endNs);
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Instrumentation *instrumentation_;
+        PhaseStats &phase_;
+        const char *name_;
+        std::int64_t startNs_ = 0;
+    };
+
+private:
+    struct Event {
+        const char *name;
+        const char *category;
+        std::int64_t startNs;
+        std::int64_t endNs;
+        int thread;
+    };
+
+    bool enabled_ = false;
+    bool trace_ = false;
+    Clock::time_point epoch_ = Clock::now();
+    std::vector<Event> events_;
+    std::vector<const std::type_info *> types_; // Parallel to stats.constraintTypes
+};
+
+} // namespace ShapeOp
+
+#ifdef SHAPEOP_INSTRUMENTATION
+#define SHAPEOP_PHASE_CONCAT_(a, b) a##b
+#define SHAPEOP_PHASE_NAME_(line) SHAPEOP_PHASE_CONCAT_(shapeopPhase, line)
+// Times the rest of the enclosing scope into instrumentation_.stats.<phase>
+#define SHAPEOP_PHASE(phase) \
+    ::ShapeOp::Instrumentation::Scope SHAPEOP_PHASE_NAME_(__LINE__)(instrumentation_, instrumentation_.stats.phase, #phase)
+#else
+#define SHAPEOP_PHASE(phase)
+#endif
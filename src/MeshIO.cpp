@@ -0,0 +1,328 @@
+#include "MeshIO.h"
+#include "FileIO.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace ShapeOp {
+
+std::vector<std::vector<int>> Mesh::faceList() const {
+    std::vector<std::vector<int>> faces(nFaces());
+    for (int f = 0; f < nFaces(); ++f) {
+        faces[f].assign(faceIndices.begin() + faceOffsets[f], faceIndices.begin() + faceOffsets[f + 1]);
+    }
+    return faces;
+}
+
+namespace {
+
+// Runs work(0) .. work(n - 1) on threads of their own, work(0) on the calling one
+template <typename Work>
+void parallelFor(size_t n, Work &&work) {
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < n; ++i) {
+        pool.emplace_back(work, i);
+    }
+    if (n > 0) work(0);
+    for (auto &t : pool) t.join();
+}
+
+int threadCount(int threads) {
+    return threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// A run of whole lines, with what the counting pass found in it
+struct Chunk {
+    const char *begin;
+    const char *end;
+    int lines = 0;
+    int vertices = 0;
+    int faces = 0;
+    int corners = 0;
+    std::string error{}; // First parse error, reported after all threads finish
+};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skipBlanks(const char *p, const char *end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+inline const char *lineEnd(const char *p, const char *end) {
+    const void *nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char *>(nl) : end;
+}
+
+// Statement keyword at p: 'v' or 'f' followed by a blank, or 0 for anything else
+inline char keyword(const char *p, const char *end) {
+    if (end - p >= 2 && (p[0] == 'v' || p[0] == 'f') && isBlank(p[1])) {
+        return p[0];
+    }
+    return 0;
+}
+
+void countChunk(Chunk &chunk) {
+    for (const char *line = chunk.begin; line < chunk.end;) {
+        const char *eol = lineEnd(line, chunk.end);
+        const char *p = skipBlanks(line, eol);
+        const char key = keyword(p, eol);
+        if (key == 'v') {
+            ++chunk.vertices;
+        } else if (key == 'f') {
+            ++chunk.faces;
+            for (p = skipBlanks(p + 1, eol); p < eol; p = skipBlanks(p, eol)) {
+                if (*p == '#') break;
+                ++chunk.corners;
+                while (p < eol && !isBlank(*p)) ++p;
+            }
+        }
+        ++chunk.lines;
+        // A last line without a newline ends at chunk.end, past which no pointer may point
+        line = eol == chunk.end ? eol : eol + 1;
+    }
+}
+
+// Parses the chunk straight into the mesh, starting at the given vertex, face and corner
+void parseChunk(Chunk &chunk, Mesh &mesh, int firstLine, int vertex, int face, int corner) {
+    const int nVertices = static_cast<int>(mesh.points.cols());
+    Scalar *points = mesh.points.data();
+    int *offsets = mesh.faceOffsets.data();
+    int *indices = mesh.faceIndices.data();
+
+    int lineNumber = firstLine;
+    auto fail = [&](const char *what) {
+        chunk.error = "OBJ parse error at line " + std::to_string(lineNumber) + ": " + what;
+    };
+
+    for (const char *line = chunk.begin; line < chunk.end; ++lineNumber) {
+        const char *eol = lineEnd(line, chunk.end);
+        const char *p = skipBlanks(line, eol);
+        const char key = keyword(p, eol);
+
+        if (key == 'v') {
+            p += 1;
+            for (int k = 0; k < 3; ++k) {
+                p = skipBlanks(p, eol);
+                if (p < eol && *p == '+') ++p;
+                double value;
+                auto result = std::from_chars(p, eol, value);
+                if (result.ec != std::errc()) {
+                    return fail("expected a vertex coordinate");
+                }
+                points[3 * static_cast<Eigen::Index>(vertex) + k] = static_cast<Scalar>(value);
+                p = result.ptr;
+            }
+            ++vertex;
+        } else if (key == 'f') {
+            for (p = skipBlanks(p + 1, eol); p < eol; p = skipBlanks(p, eol)) {
+                if (*p == '#') break;
+                int index;
+                auto result = std::from_chars(p, eol, index);
+                if (result.ec != std::errc() || index == 0) {
+                    return fail("expected a face vertex index");
+                }
+                // Positive indices are 1-based, negative ones count back from the last vertex so far
+                index = index > 0 ? index - 1 : vertex + index;
+                if (index < 0 || index >= nVertices) {
+                    return fail("face vertex index out of range");
+                }
+                indices[corner++] = index;
+                // Skip /vt/vn
+                for (p = result.ptr; p < eol && !isBlank(*p);) ++p;
+            }
+            offsets[++face] = corner;
+        }
+        line = eol == chunk.end ? eol : eol + 1;
+    }
+}
+
+// Items (vertices or faces) formatted per block
+constexpr int kBlockSize = 1 << 16;
+
+// Formats items [0, count) in blocks, up to one block per thread at a time, and writes
+// the blocks in order. format(begin, end, buffer) fills the buffer and returns its length.
+template <typename Format>
+void writeBlocks(OutputFile &file, int count, int threads, std::vector<std::vector<char>> &buffers,
+                 Format &&format) {
+    const int blocks = (count + kBlockSize - 1) / kBlockSize;
+    threads = std::max(1, std::min(threads, blocks));
+    buffers.resize(std::max<size_t>(buffers.size(), threads));
+    std::vector<size_t> lengths(threads);
+    for (int first = 0; first < blocks; first += threads) {
+        const int round = std::min(threads, blocks - first);
+        parallelFor(round, [&](size_t t) {
+            const int begin = (first + static_cast<int>(t)) * kBlockSize;
+            lengths[t] = format(begin, std::min(count, begin + kBlockSize), buffers[t]);
+        });
+        for (int t = 0; t < round; ++t) {
+            file.write(buffers[t].data(), lengths[t]);
+        }
+    }
+}
+
+// Longest shortest-round-trip representation of a Scalar, with room to spare
+constexpr size_t kScalarChars = 32;
+constexpr size_t kIndexChars = 12;
+
+void checkFaces(const Mesh &mesh) {
+    if (mesh.faceOffsets.empty() || mesh.faceOffsets.back() != static_cast<int>(mesh.faceIndices.size())) {
+        throw std::runtime_error("Mesh face offsets don't match its face indices");
+    }
+}
+
+} // namespace
+
+Mesh loadOBJ(const std::string &filename, int threads) {
+    MappedFile file(filename);
+    const char *data = file.data();
+    const char *end = data + file.size();
+
+    // Not worth a thread per chunk below a few MB
+    threads = static_cast<int>(std::min<size_t>(threadCount(threads), file.size() / (4 << 20) + 1));
+
+    // Split at line boundaries
+    std::vector<Chunk> chunks;
+    for (const char *begin = data; begin < end;) {
+        const char *split = data + file.size() / threads * (chunks.size() + 1);
+        const char *stop = end;
+        if (chunks.size() + 1 < static_cast<size_t>(threads) && split < end) {
+            const char *eol = lineEnd(std::max(split, begin), end);
+            stop = eol == end ? end : eol + 1;
+        }
+        chunks.push_back(Chunk{begin, stop});
+        begin = stop;
+    }
+
+    // Pass 1: count, so everything below is allocated once at its final size
+    parallelFor(chunks.size(), [&](size_t c) { countChunk(chunks[c]); });
+
+    std::vector<int> lines(1, 1), vertices(1, 0), faces(1, 0), corners(1, 0);
+    for (const auto &chunk : chunks) {
+        lines.push_back(lines.back() + chunk.lines);
+        vertices.push_back(vertices.back() + chunk.vertices);
+        faces.push_back(faces.back() + chunk.faces);
+        corners.push_back(corners.back() + chunk.corners);
+    }
+
+    Mesh mesh;
+    mesh.points.resize(3, vertices.back());
+    mesh.faceOffsets.assign(faces.back() + 1, 0);
+    mesh.faceIndices.resize(corners.back());
+
+    // Pass 2: parse each chunk into its own slice of the mesh
+    parallelFor(chunks.size(), [&](size_t c) { parseChunk(chunks[c], mesh, lines[c], vertices[c], faces[c], corners[c]); });
+
+    for (const auto &chunk : chunks) {
+        if (!chunk.error.empty()) {
+            throw std::runtime_error(chunk.error + " in " + filename);
+        }
+    }
+    return mesh;
+}
+
+Mesh gridMesh(const Matrix3X &points, int rows, int cols) {
+    Mesh mesh;
+    mesh.points = points;
+    mesh.faceOffsets.reserve(static_cast<size_t>(rows - 1) * (cols - 1) + 1);
+    mesh.faceIndices.reserve(static_cast<size_t>(rows - 1) * (cols - 1) * 4);
+    for (int y = 0; y + 1 < rows; ++y) {
+        for (int x = 0; x + 1 < cols; ++x) {
+            for (int corner : {y * cols + x, y * cols + x + 1, (y + 1) * cols + x + 1, (y + 1) * cols + x}) {
+                mesh.faceIndices.push_back(corner);
+            }
+            mesh.faceOffsets.push_back(static_cast<int>(mesh.faceIndices.size()));
+        }
+    }
+    return mesh;
+}
+
+void writeOBJ(const std::string &filename, const Mesh &mesh, const std::string &comment, int threads) {
+    checkFaces(mesh);
+    threads = threadCount(threads);
+    OutputFile file(filename);
+
+    std::string header;
+    for (size_t begin = 0; begin < comment.size();) {
+        size_t end = std::min(comment.find('\n', begin), comment.size());
+        header += "# " + comment.substr(begin, end - begin) + "\n";
+        begin = end + 1;
+    }
+    file.write(header);
+
+    std::vector<std::vector<char>> buffers;
+    const Scalar *points = mesh.points.data();
+    writeBlocks(file, static_cast<int>(mesh.points.cols()), threads, buffers,
+                [&](int begin, int end, std::vector<char> &buffer) {
+                    buffer.resize(static_cast<size_t>(end - begin) * (3 * kScalarChars + 4));
+                    char *p = buffer.data();
+                    for (int i = begin; i < end; ++i) {
+                        *p++ = 'v';
+                        for (int k = 0; k < 3; ++k) {
+                            *p++ = ' ';
+                            p = std::to_chars(p, p + kScalarChars, points[3 * static_cast<Eigen::Index>(i) + k]).ptr;
+                        }
+                        *p++ = '\n';
+                    }
+                    return static_cast<size_t>(p - buffer.data());
+                });
+
+    const int *offsets = mesh.faceOffsets.data();
+    const int *indices = mesh.faceIndices.data();
+    writeBlocks(file, mesh.nFaces(), threads, buffers, [&](int begin, int end, std::vector<char> &buffer) {
+        buffer.resize(static_cast<size_t>(end - begin) * 2 + (offsets[end] - offsets[begin]) * (kIndexChars + 1));
+        char *p = buffer.data();
+        for (int f = begin; f < end; ++f) {
+            *p++ = 'f';
+            for (int c = offsets[f]; c < offsets[f + 1]; ++c) {
+                *p++ = ' ';
+                p = std::to_chars(p, p + kIndexChars, indices[c] + 1).ptr; // OBJ indices are 1-based
+            }
+            *p++ = '\n';
+        }
+        return static_cast<size_t>(p - buffer.data());
+    });
+}
+
+void writePLY(const std::string &filename, const Mesh &mesh, int threads) {
+    static_assert(std::endian::native == std::endian::little, "binary PLY output assumes a little-endian host");
+    checkFaces(mesh);
+    for (int f = 0; f < mesh.nFaces(); ++f) {
+        if (mesh.faceOffsets[f + 1] - mesh.faceOffsets[f] > 255) {
+            throw std::runtime_error("Face with more than 255 corners can't be written to " + filename);
+        }
+    }
+    threads = threadCount(threads);
+    OutputFile file(filename);
+
+    const char *type = sizeof(Scalar) == sizeof(double) ? "double" : "float";
+    file.write(std::string("ply\nformat binary_little_endian 1.0\n") + "element vertex " +
+               std::to_string(mesh.points.cols()) + "\nproperty " + type + " x\nproperty " + type +
+               " y\nproperty " + type + " z\nelement face " + std::to_string(mesh.nFaces()) +
+               "\nproperty list uchar int vertex_indices\nend_header\n");
+
+    // Column-major xyz is already the vertex element's layout
+    file.write(reinterpret_cast<const char *>(mesh.points.data()), sizeof(Scalar) * mesh.points.size());
+
+    std::vector<std::vector<char>> buffers;
+    const int *offsets = mesh.faceOffsets.data();
+    const int *indices = mesh.faceIndices.data();
+    writeBlocks(file, mesh.nFaces(), threads, buffers, [&](int begin, int end, std::vector<char> &buffer) {
+        const int corners = offsets[end] - offsets[begin];
+        buffer.resize(static_cast<size_t>(end - begin) + sizeof(int) * corners);
+        char *p = buffer.data();
+        for (int f = begin; f < end; ++f) {
+            const int size = offsets[f + 1] - offsets[f];
+            *p++ = static_cast<char>(size);
+            std::memcpy(p, indices + offsets[f], sizeof(int) * size);
+            p += sizeof(int) * size;
+        }
+        return static_cast<size_t>(p - buffer.data());
+    });
+}
+
+} // namespace ShapeOp
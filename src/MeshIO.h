@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Types.h"
+#include <string>
+#include <vector>
+
+namespace ShapeOp {
+
+// Polygon mesh with faces in CSR form: face f is
+// faceIndices[faceOffsets[f]] .. faceIndices[faceOffsets[f + 1] - 1], 0-based
+struct Mesh {
+    Matrix3X points;
+    std::vector<int> faceOffsets{0};
+    std::vector<int> faceIndices;
+
+    int nFaces() const { return static_cast<int>(faceOffsets.size()) - 1; }
+
+    // Faces as the nested lists NormalForce and ConstraintBuilder::uniqueEdges take
+    std::vector<std::vector<int>> faceList() const;
+};
+
+// Loads vertex positions and faces from a Wavefront OBJ file. The file is memory-mapped
+// and parsed in parallel chunks of lines (threads = 0 uses every hardware thread).
+// Face corners may be v, v/vt, v//vn or v/vt/vn; only the vertex index is kept, and
+// negative (relative) indices are resolved. vt, vn and other statements are skipped.
+// Throws std::runtime_error if the file can't be read or a line is malformed.
+Mesh loadOBJ(const std::string &filename, int threads = 0);
+
+// Quad faces of a rows x cols grid of points indexed y * cols + x, as the examples build them
+Mesh gridMesh(const Matrix3X &points, int rows, int cols);
+
+// Writers format blocks of vertices and faces into large buffers, in parallel (threads = 0
+// uses every hardware thread), and hand each buffer to the OS in one write.
+// Both throw std::runtime_error if the file can't be written.
+
+// Wavefront OBJ with coordinates in their shortest exact form, so loadOBJ reads back the
+// same points. Each line of the comment becomes a "# " line at the top of the file.
+void writeOBJ(const std::string &filename, const Mesh &mesh, const std::string &comment = "", int threads = 0);
+
+// Binary little-endian PLY, with Scalar coordinates and faces of at most 255 corners
+void writePLY(const std::string &filename, const Mesh &mesh, int threads = 0);
+
+} // namespace ShapeOp
@@ -1,11 +1,136 @@
 #include "NormalForce.h"
 
+#include <algorithm>
+
 namespace ShapeOp {
 
-NormalForce::NormalForce(const std::vector<std::vector<int>> &faces, double magnitude)
-    : faces_(faces), magnitude_(magnitude) {}
+NormalForce::NormalForce(const std::vector<std::vector<int>> &faces, double magnitude, Mode mode)
+    : faces_(faces), magnitude_(magnitude), mode_(mode) {
+    if (mode_ != Mode::Incidence) {
+        return;
+    }
+
+    // Build the vertex->face table once (counting sort over face corners)
+    int numVertices = 0;
+    for (const auto &face : faces_) {
+        for (int v : face) {
+            numVertices = std::max(numVertices, v + 1);
+        }
+    }
+
+    incidenceOffsets_.assign(numVertices + 1, 0);
+    for (const auto &face : faces_) {
+        for (size_t k = 0; k < face.size(); ++k) {
+            // A vertex repeated within a face still only sees that face once
+            if (std::find(face.begin(), face.begin() + k, face[k]) == face.begin() + k) {
+                ++incidenceOffsets_[face[k] + 1];
+            }
+        }
+    }
+    for (int v = 0; v < numVertices; ++v) {
+        incidenceOffsets_[v + 1] += incidenceOffsets_[v];
+    }
+
+    incidenceFaces_.resize(incidenceOffsets_[numVertices]);
+    std::vector<int> fill(incidenceOffsets_.begin(), incidenceOffsets_.end() - 1);
+    for (int f = 0; f < static_cast<int>(faces_.size()); ++f) {
+        const auto &face = faces_[f];
+        for (size_t k = 0; k < face.size(); ++k) {
+            if (std::find(face.begin(), face.begin() + k, face[k]) == face.begin() + k) {
+                incidenceFaces_[fill[face[k]]++] = f;
+            }
+        }
+    }
+}
 
 Vector3 NormalForce::get(const Matrix3X &positions, int id) const {
+    if (mode_ == Mode::Scan) {
+        return getScan(positions, id);
+    }
+
+    if (!isCached(positions, id)) {
+        update(positions);
+    }
+    return fromCache(id);
+}
+
+void NormalForce::addForces(const Matrix3X &positions, Matrix3X &out) const {
+    if (mode_ == Mode::Scan) {
+        BatchForce::addForces(positions, out);
+        return;
+    }
+
+    update(positions);
+    const int n = std::min(static_cast<int>(positions.cols()), static_cast<int>(incidenceOffsets_.size()) - 1);
+    for (int i = 0; i < n; ++i) {
+        out.col(i) += fromCache(i);
+    }
+}
+
+Vector3 NormalForce::fromCache(int id) const {
+    Vector3 accumulatedNormal = Vector3::Zero();
+    if (id + 1 < static_cast<int>(incidenceOffsets_.size())) {
+        for (int k = incidenceOffsets_[id]; k < incidenceOffsets_[id + 1]; ++k) {
+            accumulatedNormal += faceNormals_.col(incidenceFaces_[k]);
+        }
+    }
+
+    // Normalize the accumulated normal
+    if (accumulatedNormal.norm() > 0) {
+        accumulatedNormal.normalize();
+    }
+
+    // Apply the force in the direction of the normal
+    return magnitude_ * accumulatedNormal;
+}
+
+void NormalForce::update(const Matrix3X &positions) const {
+    faceNormals_.resize(3, faces_.size());
+    for (int f = 0; f < static_cast<int>(faces_.size()); ++f) {
+        const auto &face = faces_[f];
+        faceNormals_.col(f).setZero();
+        if (face.size() < 3) {
+            continue;
+        }
+
+        // Same arithmetic as the scan path so both modes agree bit for bit
+        Vector3 v0 = positions.col(face[0]);
+        Vector3 v1 = positions.col(face[1]);
+        Vector3 v2 = positions.col(face[2]);
+        Vector3 normal = (v1 - v0).cross(v2 - v0);
+        double area = normal.norm();
+        if (area > 0) {
+            normal.normalize();
+            faceNormals_.col(f) = area * normal;
+        }
+    }
+
+    cachedPositions_ = positions;
+    cachedData_ = positions.data();
+}
+
+bool NormalForce::isCached(const Matrix3X &positions, int id) const {
+    if (cachedData_ != positions.data() || cachedPositions_.cols() != positions.cols()) {
+        return false;
+    }
+    if (id + 1 >= static_cast<int>(incidenceOffsets_.size())) {
+        return true;
+    }
+
+    // The solver usually reuses one buffer across iterations, so also check that
+    // every corner feeding this vertex's faces is unchanged since the last sweep.
+    for (int k = incidenceOffsets_[id]; k < incidenceOffsets_[id + 1]; ++k) {
+        const auto &face = faces_[incidenceFaces_[k]];
+        for (size_t c = 0; c < face.size() && c < 3; ++c) {
+            if (positions.col(face[c]) != cachedPositions_.col(face[c])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Vector3 NormalForce::getScan(const Matrix3X &positions, int id) const {
     Vector3 accumulatedNormal = Vector3::Zero();
 
     // Iterate over all faces
@@ -35,4 +160,4 @@ Vector3 NormalForce::get(const Matrix3X &positions, int id) const {
     return magnitude_ * accumulatedNormal;
 }
 
-} // namespace ShapeOp
\ No newline at end of file
+} // namespace ShapeOp
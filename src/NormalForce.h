@@ -1,18 +1,48 @@
 #pragma once
 
+#include "BatchForce.h"
 #include "Force.h"
 #include "Types.h"
 
 namespace ShapeOp {
 
-class NormalForce : public Force {
+class NormalForce : public BatchForce {
 public:
-    NormalForce(const std::vector<std::vector<int>> &faces, double magnitude);
+    enum class Mode {
+        Scan,     // Scan every face on each query (O(F) per vertex)
+        Incidence // CSR vertex->face table with face normals cached per positions buffer (O(valence) per vertex)
+    };
+
+    NormalForce(const std::vector<std::vector<int>> &faces, double magnitude, Mode mode = Mode::Incidence);
     virtual Vector3 get(const Matrix3X &positions, int id) const override;
 
+    // Refreshes the face normals once and then sums them per vertex (Incidence mode)
+    virtual void addForces(const Matrix3X &positions, Matrix3X &out) const override;
+
+    // Recompute all area-weighted face normals in one sweep (Incidence mode).
+    // get() calls this on its own whenever the positions it is handed differ from the cached ones.
+    void update(const Matrix3X &positions) const;
+
+    Mode getMode() const { return mode_; }
+
 private:
+    Vector3 getScan(const Matrix3X &positions, int id) const;
+    bool isCached(const Matrix3X &positions, int id) const;
+    Vector3 fromCache(int id) const;
+
     std::vector<std::vector<int>> faces_; // List of faces (each face is a list of vertex indices)
     double magnitude_;                    // Magnitude of the normal force
+    Mode mode_;
+
+    // Vertex->face incidence in CSR form, faces listed in ascending order per vertex
+    std::vector<int> incidenceOffsets_;
+    std::vector<int> incidenceFaces_;
+
+    // Per-iteration cache, keyed on the positions buffer it was computed from.
+    // Not thread-safe: concurrent get() calls on stale positions race on the refresh.
+    mutable Matrix3X faceNormals_;     // Area-weighted normal per face
+    mutable Matrix3X cachedPositions_; // Positions the face normals were computed from
+    mutable const Scalar *cachedData_ = nullptr;
 };
 
-} // namespace ShapeOp
\ No newline at end of file
+} // namespace ShapeOp
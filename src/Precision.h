@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Types.h"
+
+namespace ShapeOp {
+
+// Scalar type of ExtendedSolver's global system: its matrix, factorization, right-hand
+// side and solution. Scalar everywhere except in the mixed-precision build
+// (SHAPEOP_PRECISION=mixed), where Scalar is float and the global system stays double.
+#ifdef SHAPEOP_MIXED_PRECISION
+typedef double GlobalScalar;
+#else
+typedef Scalar GlobalScalar;
+#endif
+
+typedef Eigen::Matrix<GlobalScalar, Eigen::Dynamic, 1> GlobalVectorX;
+typedef Eigen::Matrix<GlobalScalar, Eigen::Dynamic, 3> GlobalMatrixX3;
+typedef Eigen::Matrix<GlobalScalar, 3, Eigen::Dynamic> GlobalMatrix3X;
+typedef Eigen::Matrix<GlobalScalar, Eigen::Dynamic, Eigen::Dynamic> GlobalMatrixXX;
+typedef Eigen::SparseMatrix<GlobalScalar> GlobalSparseMatrix;
+
+} // namespace ShapeOp
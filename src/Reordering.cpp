@@ -0,0 +1,206 @@
+#include "Reordering.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace ShapeOp {
+
+namespace {
+
+// Undirected graph in CSR form, each vertex's neighbours sorted by degree
+struct Graph {
+    std::vector<int> offsets;
+    std::vector<int> neighbours;
+
+    int degree(int v) const { return offsets[v + 1] - offsets[v]; }
+};
+
+Graph buildGraph(int n, const Eigen::Matrix2Xi &edges) {
+    Graph g;
+    g.offsets.assign(n + 1, 0);
+    for (int e = 0; e < edges.cols(); ++e) {
+        const int a = edges(0, e), b = edges(1, e);
+        if (a < 0 || b < 0 || a >= n || b >= n) {
+            throw std::runtime_error("reverseCuthillMcKee: edge vertex out of range");
+        }
+        if (a != b) {
+            ++g.offsets[a + 1];
+            ++g.offsets[b + 1];
+        }
+    }
+    for (int v = 0; v < n; ++v) {
+        g.offsets[v + 1] += g.offsets[v];
+    }
+    g.neighbours.resize(g.offsets[n]);
+    std::vector<int> cursor(g.offsets.begin(), g.offsets.end() - 1);
+    for (int e = 0; e < edges.cols(); ++e) {
+        const int a = edges(0, e), b = edges(1, e);
+        if (a != b) {
+            g.neighbours[cursor[a]++] = b;
+            g.neighbours[cursor[b]++] = a;
+        }
+    }
+    for (int v = 0; v < n; ++v) {
+        std::stable_sort(g.neighbours.begin() + g.offsets[v], g.neighbours.begin() + g.offsets[v + 1],
+                         [&](int x, int y) { return g.degree(x) < g.degree(y); });
+    }
+    return g;
+}
+
+// Breadth-first search from root within its component, appending the vertices to
+// queue in visiting order; returns the number of levels and leaves the last level's
+// vertices at the end of queue from lastLevel
+int breadthFirst(const Graph &g, int root, std::vector<char> &visited, std::vector<int> &queue, size_t &lastLevel) {
+    const size_t first = queue.size();
+    queue.push_back(root);
+    visited[root] = 1;
+    int levels = 0;
+    for (size_t begin = first; begin < queue.size();) {
+        const size_t end = queue.size();
+        lastLevel = begin;
+        for (size_t k = begin; k < end; ++k) {
+            const int v = queue[k];
+            for (int i = g.offsets[v]; i < g.offsets[v + 1]; ++i) {
+                const int w = g.neighbours[i];
+                if (!visited[w]) {
+                    visited[w] = 1;
+                    queue.push_back(w);
+                }
+            }
+        }
+        begin = end;
+        ++levels;
+    }
+    return levels;
+}
+
+} // namespace
+
+std::vector<int> reverseCuthillMcKee(int n, const Eigen::Matrix2Xi &edges) {
+    const Graph g = buildGraph(n, edges);
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<char> visited(n, 0), probed(n, 0);
+    std::vector<int> queue;
+    for (int start = 0; start < n; ++start) {
+        if (visited[start]) {
+            continue;
+        }
+        // Pseudo-peripheral root (George and Liu): restart from a lowest degree vertex
+        // of the last level while that makes the level structure deeper
+        int root = start, levels = 0;
+        for (;;) {
+            queue.clear();
+            size_t lastLevel = 0;
+            const int depth = breadthFirst(g, root, probed, queue, lastLevel);
+            for (int v : queue) {
+                probed[v] = 0;
+            }
+            if (depth <= levels) {
+                break;
+            }
+            levels = depth;
+            int next = queue[lastLevel];
+            for (size_t k = lastLevel; k < queue.size(); ++k) {
+                if (g.degree(queue[k]) < g.degree(next)) {
+                    next = queue[k];
+                }
+            }
+            if (next == root) {
+                break;
+            }
+            root = next;
+        }
+        size_t lastLevel = 0;
+        const size_t first = order.size();
+        breadthFirst(g, root, visited, order, lastLevel);
+        std::reverse(order.begin() + first, order.end());
+    }
+    return order;
+}
+
+std::vector<int> mortonOrder(const Matrix3X &points) {
+    const int n = static_cast<int>(points.cols());
+    std::vector<int> order(n);
+    for (int v = 0; v < n; ++v) {
+        order[v] = v;
+    }
+    if (n == 0) {
+        return order;
+    }
+    const Vector3 lower = points.rowwise().minCoeff();
+    const Vector3 extent = points.rowwise().maxCoeff() - lower;
+    const Scalar scale = extent.maxCoeff() > 0 ? Scalar((1 << 21) - 1) / extent.maxCoeff() : Scalar(0);
+
+    // Spreads the low 21 bits of x to every third bit
+    auto spread = [](std::uint64_t x) {
+        x &= 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffull;
+        x = (x | x << 16) & 0x1f0000ff0000ffull;
+        x = (x | x << 8) & 0x100f00f00f00f00full;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+        x = (x | x << 2) & 0x1249249249249249ull;
+        return x;
+    };
+    std::vector<std::uint64_t> keys(n);
+    for (int v = 0; v < n; ++v) {
+        std::uint64_t key = 0;
+        for (int d = 0; d < 3; ++d) {
+            key |= spread(static_cast<std::uint64_t>((points(d, v) - lower(d)) * scale)) << d;
+        }
+        keys[v] = key;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+std::vector<int> inverseOrder(const std::vector<int> &order) {
+    std::vector<int> inverse(order.size(), -1);
+    for (size_t k = 0; k < order.size(); ++k) {
+        inverse[order[k]] = static_cast<int>(k);
+    }
+    return inverse;
+}
+
+Mesh reorderMesh(const Mesh &mesh, const std::vector<int> &order) {
+    const int n = static_cast<int>(mesh.points.cols());
+    std::vector<int> inverse(n, -1);
+    if (static_cast<int>(order.size()) != n) {
+        throw std::runtime_error("reorderMesh: order doesn't match the vertex count");
+    }
+    for (int k = 0; k < n; ++k) {
+        if (order[k] < 0 || order[k] >= n || inverse[order[k]] >= 0) {
+            throw std::runtime_error("reorderMesh: order isn't a permutation");
+        }
+        inverse[order[k]] = k;
+    }
+
+    Mesh result;
+    result.points.resize(3, n);
+    for (int k = 0; k < n; ++k) {
+        result.points.col(k) = mesh.points.col(order[k]);
+    }
+
+    // Faces by their smallest new vertex, ties in their old order
+    std::vector<std::pair<int, int>> keyed(mesh.nFaces());
+    for (int f = 0; f < mesh.nFaces(); ++f) {
+        int smallest = n;
+        for (int i = mesh.faceOffsets[f]; i < mesh.faceOffsets[f + 1]; ++i) {
+            smallest = std::min(smallest, inverse[mesh.faceIndices[i]]);
+        }
+        keyed[f] = {smallest, f};
+    }
+    std::sort(keyed.begin(), keyed.end());
+    result.faceIndices.reserve(mesh.faceIndices.size());
+    result.faceOffsets.reserve(mesh.faceOffsets.size());
+    for (const auto &key : keyed) {
+        const int f = key.second;
+        for (int i = mesh.faceOffsets[f]; i < mesh.faceOffsets[f + 1]; ++i) {
+            result.faceIndices.push_back(inverse[mesh.faceIndices[i]]);
+        }
+        result.faceOffsets.push_back(static_cast<int>(result.faceIndices.size()));
+    }
+    return result;
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "MeshIO.h"
+#include "Types.h"
+#include <vector>
+
+namespace ShapeOp {
+
+// Vertex orderings for meshes whose numbering scatters neighbours through memory (large
+// OBJ exports, shuffled inputs). An order lists old vertex ids in their new sequence:
+// vertex k of the renumbered mesh is vertex order[k] of the original.
+
+// Reverse Cuthill-McKee on the graph of undirected edges over n vertices, each
+// connected component started from a pseudo-peripheral vertex; reduces the bandwidth of
+// the global matrix and keeps each constraint's vertices close together
+std::vector<int> reverseCuthillMcKee(int n, const Eigen::Matrix2Xi &edges);
+
+// Morton (Z-order) curve through the points' bounding box, 21 bits per axis; needs no
+// connectivity, and keeps spatially close vertices close in memory, which also suits
+// contact detection
+std::vector<int> mortonOrder(const Matrix3X &points);
+
+// New id per old vertex for an order
+std::vector<int> inverseOrder(const std::vector<int> &order);
+
+// Mesh renumbered by order, with faces sorted by their smallest new vertex so the edges
+// ConstraintBuilder::uniqueEdges() returns, and the constraints built from them, follow
+// the vertices. Pins and other per-vertex ids map through inverseOrder(order).
+// Throws std::runtime_error if order isn't a permutation of the mesh's vertices.
+Mesh reorderMesh(const Mesh &mesh, const std::vector<int> &order);
+
+} // namespace ShapeOp
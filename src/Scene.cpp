@@ -0,0 +1,429 @@
+#include "Scene.h"
+#include "ConstraintBuilder.h"
+#include "FileIO.h"
+#include "NormalForce.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace ShapeOp {
+
+static_assert(std::endian::native == std::endian::little, "scene files assume a little-endian host");
+
+bool Scene::setUp(ExtendedSolver &solver, std::pmr::memory_resource *resource) const {
+    solver.setPoints(points);
+
+    ConstraintBuilder builder(points, resource);
+    std::vector<std::shared_ptr<Constraint>> constraints;
+    builder.closeness(closenessIds, closenessWeights, constraints);
+    for (Eigen::Index k = 0; k < closenessIds.size(); ++k) {
+        std::static_pointer_cast<ClosenessConstraint>(constraints[k])->setPosition(closenessTargets.col(k));
+    }
+    if (edges.cols() > 0) {
+        if (packEdges) {
+            constraints.push_back(builder.edgeStrainBlock(edges, edgeWeights, edgeRangeMin, edgeRangeMax));
+        } else {
+            builder.edgeStrain(edges, edgeWeights, edgeRangeMin, edgeRangeMax, constraints);
+        }
+    }
+    addConstraints(solver, constraints);
+    for (Eigen::Index k = 0; k < fixedIds.size(); ++k) {
+        solver.fixVertex(fixedIds[k], fixedPositions.col(k));
+    }
+
+    if (!gravity.isZero()) {
+        solver.addForces(std::make_shared<GravityForce>(gravity));
+    }
+    for (Eigen::Index k = 0; k < vertexForceIds.size(); ++k) {
+        solver.addForces(std::make_shared<VertexForce>(vertexForces.col(k), vertexForceIds[k]));
+    }
+    if (normalForceMagnitude != 0.0) {
+        std::vector<std::vector<int>> faces(normalFaceOffsets.size() - 1);
+        for (std::size_t f = 0; f < faces.size(); ++f) {
+            faces[f].assign(normalFaceIndices.begin() + normalFaceOffsets[f],
+                            normalFaceIndices.begin() + normalFaceOffsets[f + 1]);
+        }
+        solver.addForces(std::make_shared<NormalForce>(faces, normalForceMagnitude));
+    }
+
+    solver.setTolerance(criterion, tolerance);
+    solver.setAndersonWindow(andersonWindow);
+    solver.setChebyshev(chebyshev);
+    solver.setGlobalSolver(globalSolver, preconditioner, cgTolerance, cgMaxIterations);
+    solver.setHierarchy(hierarchyLevels, gridRows, gridCols);
+    solver.setCycle(preSmoothing, postSmoothing, coarsestIterations);
+    solver.setFactorization(factorization);
+    return solver.initialize(dynamic, masses, damping, timestep);
+}
+
+namespace {
+
+const char kMagic[8] = {'S', 'O', 'S', 'C', 'E', 'N', 'E', '\0'};
+const std::uint32_t kVersion = 4;
+
+struct SceneHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t scalarSize;
+    std::uint32_t globalScalarSize; // Of the factorization, see Precision.h
+    std::uint32_t reserved;
+    std::uint64_t vertices;
+    std::uint64_t closeness;
+    std::uint64_t edges;
+    std::uint64_t vertexForces;
+    std::uint64_t fixed;
+    std::uint64_t normalFaces;
+    std::uint64_t normalCorners;
+    std::uint64_t factorizationSize; // 0 without a factorization
+    std::uint64_t factorizationNonZeros;
+    std::uint64_t factorizationMatrix; // Checksum of the matrix it factorizes
+    double gravity[3];
+    double normalForceMagnitude;
+    double masses;
+    double damping;
+    double timestep;
+    double tolerance;
+    double cgTolerance;
+    std::int32_t packEdges;
+    std::int32_t dynamic;
+    std::int32_t iterations;
+    std::int32_t criterion;
+    std::int32_t andersonWindow;
+    std::int32_t chebyshev;
+    std::int32_t globalSolver;
+    std::int32_t preconditioner;
+    std::int32_t cgMaxIterations;
+    std::int32_t hierarchyLevels;
+    std::int32_t gridRows;
+    std::int32_t gridCols;
+    std::int32_t preSmoothing;
+    std::int32_t postSmoothing;
+    std::int32_t coarsestIterations;
+};
+
+// Blocks start on 8-byte boundaries so every array in the mapping is aligned
+void writeBlock(OutputFile &file, const void *data, std::size_t bytes) {
+    static const char padding[8] = {};
+    file.write(static_cast<const char *>(data), bytes);
+    file.write(padding, (8 - bytes % 8) % 8);
+}
+
+class BlockReader {
+public:
+    BlockReader(const MappedFile &file, const std::string &filename)
+        : p_(file.data()), end_(file.data() + file.size()), filename_(filename) {}
+
+    void read(void *data, std::size_t bytes) {
+        const std::size_t padded = (bytes + 7) / 8 * 8;
+        if (static_cast<std::size_t>(end_ - p_) < padded) {
+            throw std::runtime_error("Truncated scene file: " + filename_);
+        }
+        if (bytes > 0) std::memcpy(data, p_, bytes);
+        p_ += padded;
+    }
+
+private:
+    const char *p_;
+    const char *end_;
+    std::string filename_;
+};
+
+// Ids must index the scene's vertices
+bool inRange(const int *ids, std::size_t count, Eigen::Index size) {
+    for (std::size_t k = 0; k < count; ++k) {
+        if (ids[k] < 0 || ids[k] >= size) return false;
+    }
+    return true;
+}
+
+// Throws unless every index read from the file is in range for setUp() and the
+// factorization, so a malformed file can't make them read out of bounds
+void validate(const Scene &scene, const std::string &filename) {
+    auto fail = [&](const std::string &what) {
+        throw std::runtime_error("Corrupt scene file " + filename + ": " + what);
+    };
+    const Eigen::Index vertices = scene.points.cols();
+    if (!inRange(scene.closenessIds.data(), scene.closenessIds.size(), vertices)) {
+        fail("closeness vertex out of range");
+    }
+    if (!inRange(scene.edges.data(), scene.edges.size(), vertices)) {
+        fail("edge vertex out of range");
+    }
+    if (!inRange(scene.vertexForceIds.data(), scene.vertexForceIds.size(), vertices)) {
+        fail("force vertex out of range");
+    }
+    if (!inRange(scene.fixedIds.data(), scene.fixedIds.size(), vertices)) {
+        fail("pinned vertex out of range");
+    }
+    if (!inRange(scene.normalFaceIndices.data(), scene.normalFaceIndices.size(), vertices)) {
+        fail("normal force face vertex out of range");
+    }
+    const std::vector<int> &offsets = scene.normalFaceOffsets;
+    if (offsets.front() != 0 || offsets.back() != static_cast<int>(scene.normalFaceIndices.size()) ||
+        !std::is_sorted(offsets.begin(), offsets.end())) {
+        fail("normal force face offsets out of order");
+    }
+    switch (scene.criterion) {
+    case ExtendedSolver::StopCriterion::None:
+    case ExtendedSolver::StopCriterion::Energy:
+    case ExtendedSolver::StopCriterion::Displacement:
+    case ExtendedSolver::StopCriterion::Residual:
+        break;
+    default:
+        fail("unknown stop criterion");
+    }
+    if (static_cast<int>(scene.iterations) < 0 || scene.andersonWindow < 0) {
+        fail("negative iteration count or Anderson window");
+    }
+    switch (scene.globalSolver) {
+    case ExtendedSolver::GlobalSolver::Direct:
+    case ExtendedSolver::GlobalSolver::ConjugateGradient:
+        break;
+    default:
+        fail("unknown global solver");
+    }
+    switch (scene.preconditioner) {
+    case ExtendedSolver::Preconditioner::Jacobi:
+    case ExtendedSolver::Preconditioner::IncompleteCholesky:
+        break;
+    default:
+        fail("unknown preconditioner");
+    }
+    if (scene.cgMaxIterations < 0 || scene.gridRows < 0 || scene.gridCols < 0 || scene.preSmoothing < 0 ||
+        scene.postSmoothing < 0 || scene.coarsestIterations < 0) {
+        fail("negative global solver or hierarchy setting");
+    }
+
+    if (!scene.factorization) return;
+    const SymbolicFactorization &f = scene.factorization->symbolic;
+    const Eigen::Index n = scene.factorization->D.size();
+    const int *outer = f.L.outerIndexPtr();
+    if (!inRange(f.P.indices().data(), n, n) || !inRange(f.Pinv.indices().data(), n, n)) {
+        fail("factorization permutation out of range");
+    }
+    for (Eigen::Index k = 0; k < n; ++k) {
+        if (f.Pinv.indices()[f.P.indices()[k]] != k) fail("factorization permutations don't match");
+        if (f.parent[k] < -1 || f.parent[k] >= n) fail("factorization elimination tree out of range");
+        if (outer[k + 1] < outer[k] || f.nonZerosPerCol[k] != outer[k + 1] - outer[k]) {
+            fail("factorization column offsets out of order");
+        }
+    }
+    if (outer[0] != 0 || outer[n] != f.L.nonZeros()) {
+        fail("factorization column offsets out of order");
+    }
+    if (!inRange(f.L.innerIndexPtr(), f.L.nonZeros(), n)) {
+        fail("factorization row out of range");
+    }
+}
+
+} // namespace
+
+void saveScene(const std::string &filename, const Scene &scene) {
+    const LDLTFactorization *f = scene.factorization.get();
+
+    SceneHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.scalarSize = sizeof(Scalar);
+    header.globalScalarSize = sizeof(GlobalScalar);
+    header.vertices = scene.points.cols();
+    header.closeness = scene.closenessIds.size();
+    header.edges = scene.edges.cols();
+    header.vertexForces = scene.vertexForceIds.size();
+    header.fixed = scene.fixedIds.size();
+    header.normalFaces = scene.normalFaceOffsets.size() - 1;
+    header.normalCorners = scene.normalFaceIndices.size();
+    header.factorizationSize = f ? f->D.size() : 0;
+    header.factorizationNonZeros = f ? f->symbolic.L.nonZeros() : 0;
+    header.factorizationMatrix = f ? f->matrix : 0;
+    for (int k = 0; k < 3; ++k) header.gravity[k] = scene.gravity[k];
+    header.normalForceMagnitude = scene.normalForceMagnitude;
+    header.masses = scene.masses;
+    header.damping = scene.damping;
+    header.timestep = scene.timestep;
+    header.tolerance = scene.tolerance;
+    header.cgTolerance = scene.cgTolerance;
+    header.packEdges = scene.packEdges;
+    header.dynamic = scene.dynamic;
+    header.iterations = static_cast<std::int32_t>(scene.iterations);
+    header.criterion = static_cast<std::int32_t>(scene.criterion);
+    header.andersonWindow = scene.andersonWindow;
+    header.chebyshev = scene.chebyshev;
+    header.globalSolver = static_cast<std::int32_t>(scene.globalSolver);
+    header.preconditioner = static_cast<std::int32_t>(scene.preconditioner);
+    header.cgMaxIterations = scene.cgMaxIterations;
+    header.hierarchyLevels = scene.hierarchyLevels;
+    header.gridRows = scene.gridRows;
+    header.gridCols = scene.gridCols;
+    header.preSmoothing = scene.preSmoothing;
+    header.postSmoothing = scene.postSmoothing;
+    header.coarsestIterations = scene.coarsestIterations;
+
+    const std::size_t closeness = header.closeness, edges = header.edges, forces = header.vertexForces,
+                      fixed = header.fixed;
+    if (scene.closenessWeights.size() != static_cast<Eigen::Index>(closeness) ||
+        scene.closenessTargets.cols() != static_cast<Eigen::Index>(closeness) ||
+        scene.edgeWeights.size() != static_cast<Eigen::Index>(edges) ||
+        scene.edgeRangeMin.size() != static_cast<Eigen::Index>(edges) ||
+        scene.edgeRangeMax.size() != static_cast<Eigen::Index>(edges) ||
+        scene.vertexForces.cols() != static_cast<Eigen::Index>(forces) ||
+        scene.fixedPositions.cols() != static_cast<Eigen::Index>(fixed)) {
+        throw std::runtime_error("Inconsistent scene array sizes, not writing " + filename);
+    }
+    if (f && !f->symbolic.L.isCompressed()) {
+        throw std::runtime_error("Scene factorization is not compressed, not writing " + filename);
+    }
+
+    OutputFile file(filename);
+    writeBlock(file, &header, sizeof(header));
+    writeBlock(file, scene.points.data(), sizeof(Scalar) * scene.points.size());
+    writeBlock(file, scene.closenessIds.data(), sizeof(int) * closeness);
+    writeBlock(file, scene.closenessWeights.data(), sizeof(Scalar) * closeness);
+    writeBlock(file, scene.closenessTargets.data(), sizeof(Scalar) * 3 * closeness);
+    writeBlock(file, scene.edges.data(), sizeof(int) * 2 * edges);
+    writeBlock(file, scene.edgeWeights.data(), sizeof(Scalar) * edges);
+    writeBlock(file, scene.edgeRangeMin.data(), sizeof(Scalar) * edges);
+    writeBlock(file, scene.edgeRangeMax.data(), sizeof(Scalar) * edges);
+    writeBlock(file, scene.vertexForceIds.data(), sizeof(int) * forces);
+    writeBlock(file, scene.vertexForces.data(), sizeof(Scalar) * 3 * forces);
+    writeBlock(file, scene.fixedIds.data(), sizeof(int) * fixed);
+    writeBlock(file, scene.fixedPositions.data(), sizeof(Scalar) * 3 * fixed);
+    writeBlock(file, scene.normalFaceOffsets.data(), sizeof(int) * scene.normalFaceOffsets.size());
+    writeBlock(file, scene.normalFaceIndices.data(), sizeof(int) * scene.normalFaceIndices.size());
+    if (f) {
+        const std::size_t n = f->D.size(), nnz = f->symbolic.L.nonZeros();
+        writeBlock(file, f->symbolic.P.indices().data(), sizeof(int) * n);
+        writeBlock(file, f->symbolic.Pinv.indices().data(), sizeof(int) * n);
+        writeBlock(file, f->symbolic.parent.data(), sizeof(int) * n);
+        writeBlock(file, f->symbolic.nonZerosPerCol.data(), sizeof(int) * n);
+        writeBlock(file, f->symbolic.L.outerIndexPtr(), sizeof(int) * (n + 1));
+        writeBlock(file, f->symbolic.L.innerIndexPtr(), sizeof(int) * nnz);
+        writeBlock(file, f->symbolic.L.valuePtr(), sizeof(GlobalScalar) * nnz);
+        writeBlock(file, f->D.data(), sizeof(GlobalScalar) * n);
+    }
+}
+
+Scene loadScene(const std::string &filename) {
+    MappedFile file(filename);
+    BlockReader reader(file, filename);
+
+    SceneHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("Not a scene file: " + filename);
+    }
+    reader.read(&header, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        throw std::runtime_error("Not a scene file: " + filename);
+    }
+    if (header.scalarSize != sizeof(Scalar) || header.globalScalarSize != sizeof(GlobalScalar)) {
+        throw std::runtime_error("Scene file " + filename + " was written by a build of different precision");
+    }
+
+    // The arrays must fit in the file before they are sized from its counts. Elements
+    // are at least 4 bytes, so counts up to the file size can't overflow the sum.
+    const std::uint64_t counts[] = {header.vertices,     header.closeness,   header.edges,
+                                    header.vertexForces, header.fixed,       header.normalFaces,
+                                    header.normalCorners, header.factorizationSize, header.factorizationNonZeros};
+    for (std::uint64_t count : counts) {
+        if (count >= file.size()) {
+            throw std::runtime_error("Truncated scene file: " + filename);
+        }
+    }
+    const std::uint64_t factorizationInts =
+        header.factorizationSize > 0 ? 5 * header.factorizationSize + 1 + header.factorizationNonZeros : 0;
+    const std::uint64_t bytes =
+        sizeof(Scalar) * (3 * header.vertices + 4 * header.closeness + 3 * header.edges + 3 * header.vertexForces +
+                          3 * header.fixed) +
+        sizeof(int) * (header.closeness + 2 * header.edges + header.vertexForces + header.fixed +
+                       header.normalFaces + 1 + header.normalCorners + factorizationInts) +
+        sizeof(GlobalScalar) * (header.factorizationNonZeros + header.factorizationSize);
+    if (sizeof(header) + bytes > file.size()) {
+        throw std::runtime_error("Truncated scene file: " + filename);
+    }
+
+    Scene scene;
+    const Eigen::Index closeness = header.closeness, edges = header.edges, forces = header.vertexForces,
+                       fixed = header.fixed;
+    scene.points.resize(3, header.vertices);
+    scene.closenessIds.resize(closeness);
+    scene.closenessWeights.resize(closeness);
+    scene.closenessTargets.resize(3, closeness);
+    scene.edges.resize(2, edges);
+    scene.edgeWeights.resize(edges);
+    scene.edgeRangeMin.resize(edges);
+    scene.edgeRangeMax.resize(edges);
+    scene.vertexForceIds.resize(forces);
+    scene.vertexForces.resize(3, forces);
+    scene.fixedIds.resize(fixed);
+    scene.fixedPositions.resize(3, fixed);
+    scene.normalFaceOffsets.resize(header.normalFaces + 1);
+    scene.normalFaceIndices.resize(header.normalCorners);
+
+    reader.read(scene.points.data(), sizeof(Scalar) * scene.points.size());
+    reader.read(scene.closenessIds.data(), sizeof(int) * closeness);
+    reader.read(scene.closenessWeights.data(), sizeof(Scalar) * closeness);
+    reader.read(scene.closenessTargets.data(), sizeof(Scalar) * 3 * closeness);
+    reader.read(scene.edges.data(), sizeof(int) * 2 * edges);
+    reader.read(scene.edgeWeights.data(), sizeof(Scalar) * edges);
+    reader.read(scene.edgeRangeMin.data(), sizeof(Scalar) * edges);
+    reader.read(scene.edgeRangeMax.data(), sizeof(Scalar) * edges);
+    reader.read(scene.vertexForceIds.data(), sizeof(int) * forces);
+    reader.read(scene.vertexForces.data(), sizeof(Scalar) * 3 * forces);
+    reader.read(scene.fixedIds.data(), sizeof(int) * fixed);
+    reader.read(scene.fixedPositions.data(), sizeof(Scalar) * 3 * fixed);
+    reader.read(scene.normalFaceOffsets.data(), sizeof(int) * scene.normalFaceOffsets.size());
+    reader.read(scene.normalFaceIndices.data(), sizeof(int) * scene.normalFaceIndices.size());
+
+    for (int k = 0; k < 3; ++k) scene.gravity[k] = header.gravity[k];
+    scene.normalForceMagnitude = header.normalForceMagnitude;
+    scene.masses = header.masses;
+    scene.damping = header.damping;
+    scene.timestep = header.timestep;
+    scene.tolerance = header.tolerance;
+    scene.packEdges = header.packEdges != 0;
+    scene.dynamic = header.dynamic != 0;
+    scene.iterations = static_cast<unsigned int>(header.iterations);
+    scene.criterion = static_cast<ExtendedSolver::StopCriterion>(header.criterion);
+    scene.andersonWindow = header.andersonWindow;
+    scene.chebyshev = header.chebyshev != 0;
+    scene.globalSolver = static_cast<ExtendedSolver::GlobalSolver>(header.globalSolver);
+    scene.preconditioner = static_cast<ExtendedSolver::Preconditioner>(header.preconditioner);
+    scene.cgTolerance = header.cgTolerance;
+    scene.cgMaxIterations = header.cgMaxIterations;
+    scene.hierarchyLevels = header.hierarchyLevels;
+    scene.gridRows = header.gridRows;
+    scene.gridCols = header.gridCols;
+    scene.preSmoothing = header.preSmoothing;
+    scene.postSmoothing = header.postSmoothing;
+    scene.coarsestIterations = header.coarsestIterations;
+
+    if (header.factorizationSize > 0) {
+        const Eigen::Index n = header.factorizationSize, nnz = header.factorizationNonZeros;
+        auto f = std::make_shared<LDLTFactorization>();
+        SymbolicFactorization &s = f->symbolic;
+        s.P.resize(n);
+        s.Pinv.resize(n);
+        s.parent.resize(n);
+        s.nonZerosPerCol.resize(n);
+        s.L.resize(n, n);
+        s.L.resizeNonZeros(nnz);
+        f->D.resize(n);
+        f->matrix = header.factorizationMatrix;
+        reader.read(s.P.indices().data(), sizeof(int) * n);
+        reader.read(s.Pinv.indices().data(), sizeof(int) * n);
+        reader.read(s.parent.data(), sizeof(int) * n);
+        reader.read(s.nonZerosPerCol.data(), sizeof(int) * n);
+        reader.read(s.L.outerIndexPtr(), sizeof(int) * (n + 1));
+        reader.read(s.L.innerIndexPtr(), sizeof(int) * nnz);
+        reader.read(s.L.valuePtr(), sizeof(GlobalScalar) * nnz);
+        reader.read(f->D.data(), sizeof(GlobalScalar) * n);
+        scene.factorization = f;
+    }
+    validate(scene, filename);
+    return scene;
+}
+
+} // namespace ShapeOp
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ExtendedSolver.h"
+#include "TopologyCache.h"
+#include "Types.h"
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace ShapeOp {
+
+// Everything needed to set up an ExtendedSolver for a problem, as flat arrays that are
+// saved and loaded in bulk rather than rebuilt constraint by constraint
+struct Scene {
+    Matrix3X points; // Starting points, also the rest state constraints are built from
+
+    // ClosenessConstraints: vertex, weight and target position of each
+    Eigen::VectorXi closenessIds;
+    VectorX closenessWeights;
+    Matrix3X closenessTargets;
+
+    // EdgeStrainConstraints: one column (i, j) per edge, with its weight and length range
+    Eigen::Matrix2Xi edges;
+    VectorX edgeWeights;
+    VectorX edgeRangeMin;
+    VectorX edgeRangeMax;
+    bool packEdges = true; // One EdgeStrainBlock instead of a constraint per edge
+
+    // Hard pins (ExtendedSolver::fixVertex): vertex and position of each
+    Eigen::VectorXi fixedIds;
+    Matrix3X fixedPositions;
+
+    // Forces: gravity (none if zero), constant forces on single vertices, and a
+    // NormalForce over faces in CSR form (none if the magnitude is zero)
+    Vector3 gravity = Vector3::Zero();
+    Eigen::VectorXi vertexForceIds;
+    Matrix3X vertexForces;
+    std::vector<int> normalFaceOffsets{0};
+    std::vector<int> normalFaceIndices;
+    Scalar normalForceMagnitude = 0.0;
+
+    // Solver settings
+    bool dynamic = false;
+    Scalar masses = 1.0;
+    Scalar damping = 1.0;
+    Scalar timestep = 1.0;
+    unsigned int iterations = 1; // Per solve() call
+    ExtendedSolver::StopCriterion criterion = ExtendedSolver::StopCriterion::None;
+    Scalar tolerance = 0.0;
+    int andersonWindow = 0;
+    bool chebyshev = false;
+    ExtendedSolver::GlobalSolver globalSolver = ExtendedSolver::GlobalSolver::Direct; // See setGlobalSolver()
+    ExtendedSolver::Preconditioner preconditioner = ExtendedSolver::Preconditioner::Jacobi;
+    Scalar cgTolerance = 1e-6;
+    int cgMaxIterations = 1000;
+    int hierarchyLevels = 1; // See setHierarchy() and setCycle()
+    int gridRows = 0;
+    int gridCols = 0;
+    int preSmoothing = 1;
+    int postSmoothing = 1;
+    int coarsestIterations = 5;
+
+    // Factorization of the global matrix this scene assembles, if known (see
+    // ExtendedSolver::getFactorization); setUp() then skips factorizing, unless the
+    // scene has changed since and assembles a different matrix
+    std::shared_ptr<const LDLTFactorization> factorization;
+
+    // Sets points, constraints, forces and settings on a fresh solver and initializes it.
+    // Constraint pools take their storage from the given resource, which must outlive them.
+    bool setUp(ExtendedSolver &solver,
+               std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+};
+
+// Binary scene file: a header with the counts and settings, then each array as one
+// contiguous block, and the factorization last if the scene has one. Loading maps the
+// file and copies each block into place.
+// Both throw std::runtime_error if the file can't be read or written, and loadScene also
+// if it isn't a scene file of this build's precision (SHAPEOP_PRECISION) or holds a
+// vertex, face offset, setting or factorization index out of range. Files written
+// before pins and the global solver and hierarchy settings were saved (version 3 and
+// older) are refused rather than loaded without them.
+void saveScene(const std::string &filename, const Scene &scene);
+Scene loadScene(const std::string &filename);
+
+} // namespace ShapeOp
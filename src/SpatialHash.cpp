@@ -0,0 +1,145 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef SHAPEOP_OPENMP
+#include <omp.h>
+#endif
+
+namespace ShapeOp {
+
+namespace {
+
+// Makes room for size elements, doubling the capacity whenever it runs out
+template <typename T>
+void reserveWithSlack(std::vector<T> &v, std::size_t size) {
+    if (size > v.capacity()) {
+        v.reserve(2 * size);
+    }
+}
+
+} // namespace
+
+SpatialHash::CellRange SpatialHash::cells(const Vector3 &lower, const Vector3 &upper) const {
+    const Scalar inverse = Scalar(1.0) / cellSize_;
+    CellRange range;
+    for (int d = 0; d < 3; ++d) {
+        range.lower[d] = static_cast<int>(std::floor(lower(d) * inverse));
+        range.upper[d] = static_cast<int>(std::floor(upper(d) * inverse));
+    }
+    return range;
+}
+
+std::uint32_t SpatialHash::bucket(int x, int y, int z) const {
+    // Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+    return ((static_cast<std::uint32_t>(x) * 73856093u) ^ (static_cast<std::uint32_t>(y) * 19349663u) ^
+            (static_cast<std::uint32_t>(z) * 83492791u)) &
+           mask_;
+}
+
+void SpatialHash::build(const Matrix3X &lower, const Matrix3X &upper) {
+    items_ = static_cast<int>(lower.cols());
+
+    // Entries per item, then their offsets
+    reserveWithSlack(itemStart_, items_ + 1);
+    itemStart_.resize(items_ + 1);
+    itemStart_[0] = 0;
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < items_; ++i) {
+        const CellRange r = cells(lower.col(i), upper.col(i));
+        itemStart_[i + 1] = (r.upper[0] - r.lower[0] + 1) * (r.upper[1] - r.lower[1] + 1) * (r.upper[2] - r.lower[2] + 1);
+    }
+    for (int i = 0; i < items_; ++i) {
+        itemStart_[i + 1] += itemStart_[i];
+    }
+    const int total = itemStart_[items_];
+
+    // At least twice as many buckets as entries keeps unrelated cells apart
+    std::uint32_t buckets = 64;
+    while (buckets < 2u * static_cast<std::uint32_t>(total)) {
+        buckets *= 2;
+    }
+    mask_ = buckets - 1;
+
+    reserveWithSlack(keys_, total);
+    keys_.resize(total);
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < items_; ++i) {
+        const CellRange r = cells(lower.col(i), upper.col(i));
+        int k = itemStart_[i];
+        for (int z = r.lower[2]; z <= r.upper[2]; ++z) {
+            for (int y = r.lower[1]; y <= r.upper[1]; ++y) {
+                for (int x = r.lower[0]; x <= r.upper[0]; ++x) {
+                    keys_[k++] = bucket(x, y, z);
+                }
+            }
+        }
+    }
+
+    // Counting sort of the entries by bucket
+    reserveWithSlack(bucketStart_, buckets + 1);
+    bucketStart_.assign(buckets + 1, 0);
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < total; ++k) {
+#ifdef SHAPEOP_OPENMP
+#pragma omp atomic
+#endif
+        ++bucketStart_[keys_[k] + 1];
+    }
+    for (std::uint32_t b = 0; b < buckets; ++b) {
+        bucketStart_[b + 1] += bucketStart_[b];
+    }
+    reserveWithSlack(entries_, total);
+    entries_.resize(total);
+    cursor_.reserve(bucketStart_.capacity());
+    cursor_.assign(bucketStart_.begin(), bucketStart_.end() - 1);
+#ifdef SHAPEOP_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < items_; ++i) {
+        for (int k = itemStart_[i]; k < itemStart_[i + 1]; ++k) {
+            int slot;
+#ifdef SHAPEOP_OPENMP
+#pragma omp atomic capture
+#endif
+            slot = cursor_[keys_[k]]++;
+            entries_[slot] = i;
+        }
+    }
+#ifdef SHAPEOP_OPENMP
+    // Threads scatter in any order; sorting each bucket makes the table deterministic
+#pragma omp parallel for schedule(dynamic, 4096)
+    for (std::int64_t b = 0; b < static_cast<std::int64_t>(buckets); ++b) {
+        if (bucketStart_[b + 1] - bucketStart_[b] > 1) {
+            std::sort(entries_.begin() + bucketStart_[b], entries_.begin() + bucketStart_[b + 1]);
+        }
+    }
+#endif
+}
+
+void SpatialHash::query(const Vector3 &lower, const Vector3 &upper, std::vector<int> &candidates) const {
+    if (entries_.empty()) {
+        return;
+    }
+    const std::size_t first = candidates.size();
+    const CellRange r = cells(lower, upper);
+    for (int z = r.lower[2]; z <= r.upper[2]; ++z) {
+        for (int y = r.lower[1]; y <= r.upper[1]; ++y) {
+            for (int x = r.lower[0]; x <= r.upper[0]; ++x) {
+                const std::uint32_t b = bucket(x, y, z);
+                candidates.insert(candidates.end(), entries_.begin() + bucketStart_[b],
+                                  entries_.begin() + bucketStart_[b + 1]);
+            }
+        }
+    }
+    std::sort(candidates.begin() + first, candidates.end());
+    candidates.erase(std::unique(candidates.begin() + first, candidates.end()), candidates.end());
+}
+
+} // namespace ShapeOp
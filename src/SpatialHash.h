@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Types.h"
+#include <cstdint>
+#include <vector>
+
+namespace ShapeOp {
+
+// Broad phase for proximity queries: a uniform grid of cubic cells, hashed into a table
+// of buckets so only occupied cells cost memory. Items are axis-aligned boxes, each
+// entered into every cell its box overlaps. Entries are counting-sorted by bucket into
+// one flat array, so a query reads one contiguous run per cell. build() runs in
+// parallel when built with SHAPEOP_OPENMP and gives the same table for any thread count.
+// Its arrays keep slack when they grow, so rebuilding every iteration stops allocating
+// once the table has seen about its largest size.
+class SpatialHash {
+public:
+    explicit SpatialHash(Scalar cellSize = 1.0) { setCellSize(cellSize); }
+
+    // Edge length of a cell; about the size of a typical item works best. Takes effect
+    // at the next build().
+    void setCellSize(Scalar cellSize) { cellSize_ = cellSize; }
+    Scalar getCellSize() const { return cellSize_; }
+
+    // Rebuilds the table from scratch for items with corners lower.col(i), upper.col(i)
+    void build(const Matrix3X &lower, const Matrix3X &upper);
+
+    // Appends to candidates, sorted and without duplicates, every item entered in a cell
+    // that the box overlaps. Candidates include items of other cells sharing a bucket,
+    // so callers still test the actual geometry.
+    void query(const Vector3 &lower, const Vector3 &upper, std::vector<int> &candidates) const;
+
+    int nItems() const { return items_; }
+    std::size_t nEntries() const { return entries_.size(); }
+
+private:
+    struct CellRange {
+        int lower[3];
+        int upper[3];
+    };
+
+    CellRange cells(const Vector3 &lower, const Vector3 &upper) const;
+    std::uint32_t bucket(int x, int y, int z) const;
+
+    Scalar cellSize_ = 1.0;
+    int items_ = 0;
+    std::uint32_t mask_ = 0;            // Buckets - 1, a power of two minus one
+    std::vector<int> bucketStart_;      // First entry per bucket, plus the end
+    std::vector<int> entries_;          // Item per entry, grouped by bucket
+    std::vector<int> itemStart_;        // First entry per item, plus the end (build scratch)
+    std::vector<std::uint32_t> keys_;   // Bucket per entry in item order (build scratch)
+    std::vector<int> cursor_;           // Next free entry per bucket (build scratch)
+};
+
+} // namespace ShapeOp
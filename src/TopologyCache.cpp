@@ -0,0 +1,166 @@
+#include "TopologyCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace ShapeOp {
+
+std::shared_ptr<const SymbolicFactorization> SymbolicLDLT::symbolic() const {
+    assert(m_analysisIsOk);
+    auto s = std::make_shared<SymbolicFactorization>();
+    s->P = m_P;
+    s->Pinv = m_Pinv;
+    s->parent = m_parent;
+    s->nonZerosPerCol = m_nonZerosPerCol;
+    s->L = m_matrix;
+    return s;
+}
+
+void SymbolicLDLT::setSymbolic(const SymbolicFactorization &symbolic) {
+    // The state analyzePattern() leaves behind; factorize() fills in the values
+    m_P = symbolic.P;
+    m_Pinv = symbolic.Pinv;
+    m_parent = symbolic.parent;
+    m_nonZerosPerCol = symbolic.nonZerosPerCol;
+    m_matrix = symbolic.L;
+    // m_isInitialized is hidden by a private using-declaration in SimplicialCholeskyBase
+    this->Eigen::SparseSolverBase<Eigen::SimplicialLDLT<GlobalSparseMatrix>>::m_isInitialized = true;
+    m_info = Eigen::Success;
+    m_analysisIsOk = true;
+    m_factorizationIsOk = false;
+}
+
+std::shared_ptr<LDLTFactorization> SymbolicLDLT::factorization() const {
+    assert(m_factorizationIsOk);
+    auto f = std::make_shared<LDLTFactorization>();
+    f->symbolic = *symbolic();
+    f->D = m_diag;
+    return f;
+}
+
+void SymbolicLDLT::setFactorization(const LDLTFactorization &factorization) {
+    setSymbolic(factorization.symbolic);
+    m_diag = factorization.D;
+    m_factorizationIsOk = true;
+}
+
+void SymbolicLDLT::solve(const GlobalMatrixX3 &b, GlobalMatrixX3 &x, GlobalMatrixX3 &work) const {
+    assert(m_factorizationIsOk);
+    if (m_P.size() > 0) {
+        work.noalias() = m_P * b;
+    } else {
+        work = b;
+    }
+    if (m_matrix.nonZeros() > 0) {
+        matrixL().solveInPlace(work);
+    }
+    work.noalias() = m_diag.asDiagonal().inverse() * work;
+    if (m_matrix.nonZeros() > 0) {
+        matrixU().solveInPlace(work);
+    }
+    if (m_P.size() > 0) {
+        x.noalias() = m_Pinv * work;
+    } else {
+        x = work;
+    }
+}
+
+static std::size_t patternKey(const GlobalSparseMatrix &N) {
+    // FNV-1a over the compressed column structure
+    std::size_t key = 14695981039346656037ull;
+    auto mix = [&key](int v) { key = (key ^ static_cast<std::size_t>(static_cast<unsigned>(v))) * 1099511628211ull; };
+    mix(static_cast<int>(N.rows()));
+    for (Eigen::Index k = 0; k <= N.outerSize(); ++k) mix(N.outerIndexPtr()[k]);
+    for (Eigen::Index k = 0; k < N.nonZeros(); ++k) mix(N.innerIndexPtr()[k]);
+    return key;
+}
+
+std::uint64_t matrixChecksum(const GlobalSparseMatrix &N) {
+    std::uint64_t key = 14695981039346656037ull;
+    auto mix = [&key](std::uint64_t v) {
+        for (int byte = 0; byte < 8; ++byte, v >>= 8) {
+            key = (key ^ (v & 0xff)) * 1099511628211ull;
+        }
+    };
+    mix(static_cast<std::uint64_t>(N.rows()));
+    mix(static_cast<std::uint64_t>(N.cols()));
+    for (Eigen::Index k = 0; k < N.outerSize(); ++k) {
+        // Iterating rather than reading the arrays also covers uncompressed matrices
+        for (GlobalSparseMatrix::InnerIterator it(N, k); it; ++it) {
+            std::uint64_t bits = 0;
+            const GlobalScalar value = it.value();
+            std::memcpy(&bits, &value, sizeof(value));
+            mix(static_cast<std::uint64_t>(it.index()));
+            mix(bits);
+        }
+        mix(~std::uint64_t(0)); // Column end
+    }
+    return key;
+}
+
+std::shared_ptr<const SymbolicFactorization> TopologyCache::find(std::size_t key, const GlobalSparseMatrix &N) const {
+    const int *outer = N.outerIndexPtr();
+    const int *inner = N.innerIndexPtr();
+    auto range = entries_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry &e = it->second;
+        if (static_cast<Eigen::Index>(e.outer.size()) == N.outerSize() + 1 &&
+            static_cast<Eigen::Index>(e.inner.size()) == N.nonZeros() &&
+            std::equal(e.outer.begin(), e.outer.end(), outer) && std::equal(e.inner.begin(), e.inner.end(), inner)) {
+            return e.symbolic;
+        }
+    }
+    return nullptr;
+}
+
+void TopologyCache::analyzePattern(const GlobalSparseMatrix &N, SymbolicLDLT &ldlt) {
+    assert(N.isCompressed());
+    const std::size_t key = patternKey(N);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto symbolic = find(key, N)) {
+            ++hits_;
+            ldlt.setSymbolic(*symbolic);
+            return;
+        }
+        ++misses_;
+    }
+
+    // Analyze outside the lock so misses on different patterns run concurrently
+    ldlt.analyzePattern(N);
+    if (ldlt.info() != Eigen::Success) {
+        return;
+    }
+    Entry entry{std::vector<int>(N.outerIndexPtr(), N.outerIndexPtr() + N.outerSize() + 1),
+                std::vector<int>(N.innerIndexPtr(), N.innerIndexPtr() + N.nonZeros()), ldlt.symbolic()};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!find(key, N)) {
+        entries_.emplace(key, std::move(entry));
+    }
+}
+
+std::size_t TopologyCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::size_t TopologyCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::size_t TopologyCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void TopologyCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    hits_ = 0;
+    misses_ = 0;
+}
+
+} // namespace ShapeOp
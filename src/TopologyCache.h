@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Precision.h"
+#include <Eigen/SparseCholesky>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ShapeOp {
+
+// Everything SimplicialLDLT::analyzePattern computes: the fill-reducing (AMD) ordering,
+// the elimination tree and the structure of the factor
+struct SymbolicFactorization {
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P;
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> Pinv;
+    Eigen::VectorXi parent;
+    Eigen::VectorXi nonZerosPerCol;
+    GlobalSparseMatrix L;
+};
+
+// A complete factorization: the symbolic part with the values of L filled in, and D,
+// and the matrixChecksum() of the matrix it factorizes
+struct LDLTFactorization {
+    SymbolicFactorization symbolic;
+    GlobalVectorX D;
+    std::uint64_t matrix = 0;
+};
+
+// FNV-1a over the dimensions, sparsity pattern and bits of the values of N: equal for
+// equal matrices, and all but certainly different otherwise. O(nnz), far below a
+// factorization.
+std::uint64_t matrixChecksum(const GlobalSparseMatrix &N);
+
+// SimplicialLDLT whose symbolic analysis can be exported and imported, so that
+// factorize() runs without a preceding analyzePattern(), and whose numeric
+// factorization can be exported and imported, so that solve() runs without either
+class SymbolicLDLT : public Eigen::SimplicialLDLT<GlobalSparseMatrix> {
+public:
+    std::shared_ptr<const SymbolicFactorization> symbolic() const;
+    void setSymbolic(const SymbolicFactorization &symbolic);
+
+    std::shared_ptr<LDLTFactorization> factorization() const; // matrix left 0
+    void setFactorization(const LDLTFactorization &factorization);
+
+    // x = N^-1 b with the same arithmetic as solve(), but permuting through work rather
+    // than in place, which allocates; no allocation once x and work are b's size
+    void solve(const GlobalMatrixX3 &b, GlobalMatrixX3 &x, GlobalMatrixX3 &work) const;
+    using Eigen::SimplicialLDLT<GlobalSparseMatrix>::solve;
+};
+
+// Symbolic factorizations shared between solvers, keyed on the sparsity pattern of the
+// global matrix. Safe to use from several threads; two threads missing on the same
+// pattern at once both analyze it and the first result is kept.
+class TopologyCache {
+public:
+    // Same effect as ldlt.analyzePattern(N), reusing a cached analysis when N's pattern
+    // has been seen before
+    void analyzePattern(const GlobalSparseMatrix &N, SymbolicLDLT &ldlt);
+
+    std::size_t size() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+    void clear();
+
+private:
+    struct Entry {
+        std::vector<int> outer;
+        std::vector<int> inner;
+        std::shared_ptr<const SymbolicFactorization> symbolic;
+    };
+
+    std::shared_ptr<const SymbolicFactorization> find(std::size_t key, const GlobalSparseMatrix &N) const;
+
+    mutable std::mutex mutex_;
+    std::unordered_multimap<std::size_t, Entry> entries_;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+} // namespace ShapeOp
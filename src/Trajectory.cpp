@@ -0,0 +1,260 @@
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace ShapeOp {
+
+static_assert(std::endian::native == std::endian::little, "trajectory files assume a little-endian host");
+
+static const char kMagic[8] = {'S', 'O', 'T', 'R', 'A', 'J', '\0', '\0'};
+static const std::uint32_t kVersion = 1;
+static const std::size_t kMaxPending = 8; // Frames record() queues before waiting
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string &filename, const Mesh &topology, Scalar quantization,
+                                       int keyframeInterval)
+    : file_(filename),
+      vertices_(static_cast<std::uint32_t>(topology.points.cols())),
+      quantization_(static_cast<float>(quantization)),
+      keyframeInterval_(std::max(1, keyframeInterval)) {
+    TrajectoryHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.vertices = vertices_;
+    header.faces = static_cast<std::uint32_t>(topology.nFaces());
+    header.corners = static_cast<std::uint32_t>(topology.faceIndices.size());
+    header.keyframeInterval = static_cast<std::uint32_t>(keyframeInterval_);
+    header.quantization = quantization_;
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file_.write(reinterpret_cast<const char *>(topology.faceOffsets.data()), sizeof(int) * topology.faceOffsets.size());
+    file_.write(reinterpret_cast<const char *>(topology.faceIndices.data()), sizeof(int) * topology.faceIndices.size());
+
+    worker_ = std::thread(&TrajectoryRecorder::work, this);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    try {
+        close();
+    } catch (const std::exception &) {
+    }
+}
+
+void TrajectoryRecorder::record(const Matrix3X &points) {
+    if (points.cols() != static_cast<Eigen::Index>(vertices_)) {
+        throw std::runtime_error("Trajectory frame has " + std::to_string(points.cols()) + " points, expected " +
+                                 std::to_string(vertices_));
+    }
+    Matrix3X buffer;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        room_.wait(lock, [this] { return pending_.size() < kMaxPending; });
+        if (!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+        if (stop_) {
+            throw std::runtime_error("Trajectory recorder is closed");
+        }
+        if (!free_.empty()) {
+            buffer = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+    buffer = points; // Reuses the recycled storage, same size every frame
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(buffer));
+        ++recorded_;
+    }
+    wake_.notify_one();
+}
+
+void TrajectoryRecorder::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!stop_) {
+            stop_ = true;
+            wake_.notify_one();
+        }
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+void TrajectoryRecorder::work() {
+    for (;;) {
+        Matrix3X points;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return; // Stopped and drained
+            }
+            points = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        room_.notify_one();
+        if (error_.empty()) {
+            try {
+                encode(points);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = e.what();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(points));
+    }
+}
+
+void TrajectoryRecorder::encode(const Matrix3X &points) {
+    const Eigen::Index n = 3 * static_cast<Eigen::Index>(vertices_);
+    const Scalar *p = points.data();
+    TrajectoryFrame frame;
+
+    if (written_ % keyframeInterval_ == 0) {
+        frame.kind = TrajectoryFrame::Key;
+        reconstructed_ = points.cast<float>();
+        frame.bytes = static_cast<std::uint32_t>(sizeof(float) * n);
+        buffer_.resize(sizeof(frame) + frame.bytes);
+        std::memcpy(buffer_.data() + sizeof(frame), reconstructed_.data(), frame.bytes);
+    } else {
+        float *r = reconstructed_.data();
+        bool quantized = quantization_ > 0.0f;
+        if (quantized) {
+            const float limit = std::numeric_limits<std::int16_t>::max() * quantization_;
+            for (Eigen::Index i = 0; i < n && quantized; ++i) {
+                quantized = std::abs(static_cast<float>(p[i]) - r[i]) < limit;
+            }
+        }
+        if (quantized) {
+            frame.kind = TrajectoryFrame::Quantized;
+            frame.bytes = static_cast<std::uint32_t>((sizeof(std::int16_t) * n + 3) / 4 * 4);
+            buffer_.assign(sizeof(frame) + frame.bytes, 0);
+            auto *q = reinterpret_cast<std::int16_t *>(buffer_.data() + sizeof(frame));
+            for (Eigen::Index i = 0; i < n; ++i) {
+                q[i] = static_cast<std::int16_t>(std::lround((static_cast<float>(p[i]) - r[i]) / quantization_));
+                r[i] += q[i] * quantization_;
+            }
+        } else {
+            frame.kind = TrajectoryFrame::Delta;
+            frame.bytes = static_cast<std::uint32_t>(sizeof(float) * n);
+            buffer_.resize(sizeof(frame) + frame.bytes);
+            auto *d = reinterpret_cast<float *>(buffer_.data() + sizeof(frame));
+            for (Eigen::Index i = 0; i < n; ++i) {
+                d[i] = static_cast<float>(p[i]) - r[i];
+                r[i] += d[i];
+            }
+        }
+    }
+
+    std::memcpy(buffer_.data(), &frame, sizeof(frame));
+    file_.write(buffer_.data(), buffer_.size());
+    ++written_;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string &filename) : file_(filename, false) {
+    const char *data = file_.data();
+    const std::size_t size = file_.size();
+    if (size < sizeof(header_)) {
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    }
+    std::memcpy(&header_, data, sizeof(header_));
+    if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0 || header_.version != kVersion) {
+        throw std::runtime_error("Not a trajectory file: " + filename);
+    }
+
+    std::size_t offset = sizeof(header_);
+    const std::size_t topologyBytes = sizeof(int) * (std::size_t(header_.faces) + 1 + header_.corners);
+    if (size < offset + topologyBytes) {
+        throw std::runtime_error("Truncated trajectory file: " + filename);
+    }
+    faceOffsets_.resize(header_.faces + 1);
+    faceIndices_.resize(header_.corners);
+    std::memcpy(faceOffsets_.data(), data + offset, sizeof(int) * faceOffsets_.size());
+    offset += sizeof(int) * faceOffsets_.size();
+    std::memcpy(faceIndices_.data(), data + offset, sizeof(int) * faceIndices_.size());
+    offset += sizeof(int) * faceIndices_.size();
+
+    // Index the frames; only their headers are touched. Every payload must be the size
+    // frame() reads for its kind.
+    const std::size_t n = 3 * std::size_t(header_.vertices);
+    const std::size_t floatBytes = sizeof(float) * n;
+    const std::size_t quantizedBytes = (sizeof(std::int16_t) * n + 3) / 4 * 4;
+    int keyframe = -1;
+    while (offset + sizeof(TrajectoryFrame) <= size) {
+        TrajectoryFrame frame;
+        std::memcpy(&frame, data + offset, sizeof(frame));
+        if (offset + sizeof(frame) + frame.bytes > size) {
+            break;
+        }
+        const bool sized = frame.kind == TrajectoryFrame::Quantized ? frame.bytes == quantizedBytes
+                                                                    : frame.bytes == floatBytes;
+        if (!sized || frame.kind > TrajectoryFrame::Quantized ||
+            (frame.kind != TrajectoryFrame::Key && keyframe < 0)) {
+            throw std::runtime_error("Corrupt trajectory file: " + filename);
+        }
+        if (frame.kind == TrajectoryFrame::Key) {
+            keyframe = frames();
+        }
+        offsets_.push_back(offset);
+        keyframes_.push_back(keyframe);
+        offset += sizeof(frame) + frame.bytes;
+    }
+}
+
+Matrix3X TrajectoryReader::frame(int index) {
+    if (index < 0 || index >= frames()) {
+        throw std::out_of_range("Trajectory frame " + std::to_string(index) + " out of range");
+    }
+    const Eigen::Index n = 3 * static_cast<Eigen::Index>(header_.vertices);
+    int start = keyframes_[index];
+    if (currentIndex_ >= start && currentIndex_ <= index) {
+        start = currentIndex_ + 1;
+    } else {
+        current_.resize(3, header_.vertices);
+    }
+
+    for (int f = start; f <= index; ++f) {
+        const char *data = file_.data() + offsets_[f];
+        TrajectoryFrame frame;
+        std::memcpy(&frame, data, sizeof(frame));
+        data += sizeof(frame);
+        float *r = current_.data();
+        if (frame.kind == TrajectoryFrame::Key) {
+            std::memcpy(r, data, sizeof(float) * n);
+        } else if (frame.kind == TrajectoryFrame::Delta) {
+            for (Eigen::Index i = 0; i < n; ++i) {
+                float d;
+                std::memcpy(&d, data + sizeof(float) * i, sizeof(float));
+                r[i] += d;
+            }
+        } else {
+            for (Eigen::Index i = 0; i < n; ++i) {
+                std::int16_t q;
+                std::memcpy(&q, data + sizeof(std::int16_t) * i, sizeof(q));
+                r[i] += q * header_.quantization;
+            }
+        }
+    }
+    currentIndex_ = index;
+    return current_.cast<Scalar>();
+}
+
+Mesh TrajectoryReader::mesh(int index) {
+    Mesh mesh;
+    mesh.points = frame(index);
+    mesh.faceOffsets = faceOffsets_;
+    mesh.faceIndices = faceIndices_;
+    return mesh;
+}
+
+} // namespace ShapeOp
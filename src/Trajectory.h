@@ -0,0 +1,125 @@
+#pragma once
+
+#include "FileIO.h"
+#include "MeshIO.h"
+#include "Types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ShapeOp {
+
+// Trajectory file layout (little-endian):
+//   TrajectoryHeader
+//   int32 faceOffsets[faces + 1], int32 faceIndices[corners]
+//   frames, each a TrajectoryFrame followed by its payload:
+//     Key        float32 positions[3 * vertices]
+//     Delta      float32 deltas[3 * vertices] from the previous frame
+//     Quantized  int16 deltas[3 * vertices] in units of the header's quantization step,
+//                padded to a multiple of 4 bytes
+// Deltas are taken from the previous frame as the reader reconstructs it, so rounding and
+// quantization errors don't build up along the chain.
+struct TrajectoryHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t vertices;
+    std::uint32_t faces;
+    std::uint32_t corners;
+    std::uint32_t keyframeInterval;
+    float quantization; // 0 for float32 deltas
+};
+
+struct TrajectoryFrame {
+    enum Kind : std::uint32_t { Key = 0, Delta = 1, Quantized = 2 };
+
+    std::uint32_t kind;
+    std::uint32_t bytes; // Payload size
+};
+
+// Appends positions to a trajectory file. record() only copies the points into a queue;
+// encoding and writing happen on a background thread, so a solve loop doesn't wait on
+// the disk unless it gets several frames ahead, when record() waits for room so the
+// queue's memory stays bounded. Point buffers are recycled once written, so recording a
+// frame doesn't allocate in steady state.
+class TrajectoryRecorder {
+public:
+    // The topology's faces go into the header, its points only fix the vertex count.
+    // quantization > 0 stores deltas as multiples of that step in 16 bits (frames whose
+    // deltas don't fit fall back to float32); every keyframeInterval-th frame is stored
+    // whole, which bounds the work of a random access in the reader.
+    TrajectoryRecorder(const std::string &filename, const Mesh &topology, Scalar quantization = 0.0,
+                       int keyframeInterval = 64);
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder &) = delete;
+    TrajectoryRecorder &operator=(const TrajectoryRecorder &) = delete;
+
+    // Queues one frame. Throws std::runtime_error if an earlier write failed.
+    void record(const Matrix3X &points);
+
+    // Waits until every queued frame is on disk and closes the file. Throws
+    // std::runtime_error if a write failed. Called by the destructor, which doesn't throw.
+    void close();
+
+    std::size_t frames() const { return recorded_; }
+
+private:
+    void work();
+    void encode(const Matrix3X &points);
+
+    OutputFile file_;
+    std::uint32_t vertices_;
+    float quantization_;
+    int keyframeInterval_;
+
+    // Background thread state
+    Eigen::Matrix3Xf reconstructed_; // Previous frame as the reader will see it
+    std::vector<char> buffer_;
+    std::size_t written_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable room_; // A queued frame was taken
+    std::deque<Matrix3X> pending_;
+    std::vector<Matrix3X> free_;
+    bool stop_ = false;
+    std::string error_;
+    std::atomic<std::size_t> recorded_{0};
+    std::thread worker_;
+};
+
+// Random access to the frames of a trajectory file through a memory mapping. A frame is
+// rebuilt from the keyframe at or before it, or from the last frame read when that is
+// closer, so reading frames in order costs one delta each. Not thread-safe.
+class TrajectoryReader {
+public:
+    // Throws std::runtime_error if the file can't be read, isn't a trajectory, or has a
+    // frame of unknown kind or whose payload size doesn't match its kind. A frame cut off
+    // at the end of the file (a recording that didn't close) is ignored.
+    explicit TrajectoryReader(const std::string &filename);
+
+    int frames() const { return static_cast<int>(offsets_.size()); }
+    int vertices() const { return static_cast<int>(header_.vertices); }
+
+    Matrix3X frame(int index);
+
+    // The recorded faces with the points of the given frame
+    Mesh mesh(int index);
+
+private:
+    MappedFile file_;
+    TrajectoryHeader header_;
+    std::vector<int> faceOffsets_;
+    std::vector<int> faceIndices_;
+    std::vector<std::size_t> offsets_; // Frame header offsets in the file
+    std::vector<int> keyframes_;       // Keyframe each frame starts from
+    Eigen::Matrix3Xf current_;
+    int currentIndex_ = -1;
+};
+
+} // namespace ShapeOp
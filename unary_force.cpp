@@ -1,10 +1,10 @@
 #include "pch.h"
+#include "MeshIO.h"
 #include "Solver.h"
 #include "Constraint.h"
 #include "Force.h"
 #include <iostream>
 #include <vector>
-#include <fstream>
 
 int main() {
     // Grid size - smaller grid for faster execution
@@ -101,29 +101,11 @@ int main() {
     
     // Write mesh to OBJ file
     ShapeOp::Matrix3X finalPoints = solver.getPoints();
-    std::ofstream meshFile("unary_force.obj");
-    if (meshFile.is_open()) {
-        // Write vertices
-        for (int i = 0; i < finalPoints.cols(); i++) {
-            meshFile << "v " 
-                     << finalPoints.col(i)[0] << " " 
-                     << finalPoints.col(i)[1] << " " 
-                     << finalPoints.col(i)[2] << std::endl;
-        }
-        
-        // Write faces
-        for (int y = 0; y < rows - 1; ++y) {
-            for (int x = 0; x < cols - 1; ++x) {
-                int v1 = index(x, y) + 1;
-                int v2 = index(x+1, y) + 1;
-                int v3 = index(x+1, y+1) + 1;
-                int v4 = index(x, y+1) + 1;
-                meshFile << "f " << v1 << " " << v2 << " " << v3 << " " << v4 << std::endl;
-            }
-        }
-        
-        meshFile.close();
+    try {
+        ShapeOp::writeOBJ("unary_force.obj", ShapeOp::gridMesh(finalPoints, rows, cols));
         std::cout << "Mesh written to unary_force.obj" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
     }
 
     return 0;
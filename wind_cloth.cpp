@@ -1,14 +1,36 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <string>
 #include "pch.h"
+#include "ContactConstraint.h"
+#include "ExtendedSolver.h"
+#include "MeshIO.h"
+#include "Trajectory.h"
 
 // Simple cloth simulation using ShapeOp
 // Demonstrates cloth hanging from two corners
+// Usage: wind_cloth [--contact] [--record file.traj]
+//   --contact  keep the cloth from passing through itself (slower per iteration; until the
+//              cloth touches itself it moves exactly as without)
+//   --record   record every step for playback (see ShapeOp::TrajectoryReader)
+
+int main(int argc, char **argv) {
+    bool contact = false;
+    std::string trajectory;
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        if (arg == "--contact") {
+            contact = true;
+        } else if (arg == "--record" && a + 1 < argc) {
+            trajectory = argv[++a];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--contact] [--record file.traj]" << std::endl;
+            return 1;
+        }
+    }
 
-int main() {
     // Parameters for the cloth
     const int rows = 20, cols = 20;
     double gridSize = 1.0;
@@ -33,8 +55,8 @@ int main() {
         }
     }
     
-    // Create solver
-    ShapeOp::Solver solver;
+    // Create solver; ExtendedSolver, as contacts switch rows of the global matrix
+    ShapeOp::ExtendedSolver solver;
     solver.setPoints(points);
     
     // Fix only two corners (diagonal corners)
@@ -78,6 +100,14 @@ int main() {
         }
     }
     
+    // Optionally keep the cloth from passing through itself where it folds over, with
+    // contacts a quarter of an edge thick and as stiff as the unit masses (mass / timestep^2);
+    // with one iteration per step a far stiffer contact overshoots and the cloth blows up
+    if (contact) {
+        solver.addConstraint(std::make_shared<ShapeOp::ContactConstraint>(
+            ShapeOp::gridMesh(solver.getPoints(), rows, cols).faceList(), 1.0, solver.getPoints(), 0.25 * gridSize));
+    }
+
     // Add gravity force
     ShapeOp::Vector3 gravity(0.0, -0.1, 0.0); // Y is down
     auto gravityForce = std::make_shared<ShapeOp::GravityForce>(gravity);
@@ -88,10 +118,21 @@ int main() {
     
     std::cout << "Solving cloth hanging from two corners..." << std::endl;
     
+    // Optionally record every step for playback
+    std::unique_ptr<ShapeOp::TrajectoryRecorder> recorder;
+    if (!trajectory.empty()) {
+        recorder = std::make_unique<ShapeOp::TrajectoryRecorder>(
+            trajectory, ShapeOp::gridMesh(solver.getPoints(), rows, cols));
+        recorder->record(solver.getPoints());
+    }
+
     // Solve for 100 iterations
     const int iterations = 100;
     for (int i = 0; i < iterations; ++i) {
         solver.solve(1);
+        if (recorder) {
+            recorder->record(solver.getPoints());
+        }
         
         if (i % 20 == 0) {
             std::cout << "Iteration " << i << std::endl;
@@ -99,43 +140,22 @@ int main() {
     }
     
     std::cout << "Simulation complete." << std::endl;
+    if (recorder) {
+        recorder->close();
+        std::cout << "Recorded " << recorder->frames() << " frames to " << trajectory << std::endl;
+    }
     
     // Write the final result to an OBJ file
     const ShapeOp::Matrix3X& finalPoints = solver.getPoints();
     std::string filename = "hanging_cloth.obj";
-    std::ofstream objFile(filename);
-    
-    if (!objFile.is_open()) {
-        std::cerr << "Error: Could not open " << filename << " for writing." << std::endl;
+    try {
+        ShapeOp::writeOBJ(filename, ShapeOp::gridMesh(finalPoints, rows, cols),
+                          "Hanging cloth mesh\nVertices: " + std::to_string(rows * cols) +
+                              "\nFaces: " + std::to_string((rows - 1) * (cols - 1)));
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-    
-    // Write header
-    objFile << "# Hanging cloth mesh" << std::endl;
-    objFile << "# Vertices: " << rows * cols << std::endl;
-    objFile << "# Faces: " << (rows-1) * (cols-1) << std::endl;
-    
-    // Write vertices
-    for (int i = 0; i < rows * cols; ++i) {
-        objFile << "v " 
-                << finalPoints(0, i) << " " 
-                << finalPoints(1, i) << " " 
-                << finalPoints(2, i) << std::endl;
-    }
-    
-    // Write quad faces
-    for (int y = 0; y < rows - 1; ++y) {
-        for (int x = 0; x < cols - 1; ++x) {
-            int i00 = index(x, y) + 1;       // +1 because OBJ indices start at 1
-            int i10 = index(x+1, y) + 1;
-            int i11 = index(x+1, y+1) + 1;
-            int i01 = index(x, y+1) + 1;
-            
-            objFile << "f " << i00 << " " << i10 << " " << i11 << " " << i01 << std::endl;
-        }
-    }
-    
-    objFile.close();
     std::cout << "Wrote result to " << filename << std::endl;
     
     return 0;